@@ -0,0 +1,86 @@
+#include "camera.hpp"
+#include "cli.hpp"
+#include "config.hpp"
+#include "execution.hpp"
+#include "intersect_simd.hpp"
+#include "ppm_writer.hpp"
+#include "rayos.hpp"
+#include "render_scene.hpp"
+#include "scene_cache.hpp"
+#include <cstddef>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+int main(int argc, char * argv[]) {
+  std::vector<std::string_view> args;
+  args.reserve(static_cast<std::size_t>(argc));
+  for (int i = 0; i < argc; ++i) {
+    args.emplace_back(argv[i]);  // NOLINT
+  }
+
+  CLIArgs const cli = parse_cli(args, "render-aos", CliLayout::aos);
+  Config const cfg  = parse_config(cli.config_path);
+  std::cout << "Config loaded (defaults): width=" << cfg.image_width << "\n";
+
+  LoadedScene const loaded = [&] {
+    ScopedNumaInterleave const interleave(cli.numa);
+    return load_render_scene(cli.scene_path, cli.scene_cache, cli.numa);
+  }();
+  RenderScene const & escena = loaded.scene;
+
+  Camera cam = make_camera_from_config(cfg);
+  if (cli.tile_size > 0) {
+    cam.tile_size = cli.tile_size;
+  }
+  std::cout << "Camera ready (" << cam.image_width << "x" << cam.image_height << ") \n";
+  std::cout << "Scene loaded (materials=" << escena.materials.size()
+            << ", spheres=" << escena.num_spheres() << ", cylinders=" << escena.num_cylinders()
+            << ") \n";
+  std::cout << "Scene compiled (BVH nodes=" << escena.bvh.nodes.size()
+            << ", kernels=" << intersect_kernels().name
+            << ", source=" << scene_source_name(loaded.source) << ") \n";
+
+  std::cout << "Config: " << cli.config_path << "\n";
+  std::cout << "Scene:  " << cli.scene_path << "\n";
+  std::cout << "Output: " << cli.output_path << "\n";
+  std::cout << "CLI parsing OK \n";
+
+  ImageFormat format = image_format_from_path(cli.output_path);
+  if (cli.format == "p6") {
+    format = ImageFormat::p6;
+  } else if (cli.format == "p3") {
+    format = ImageFormat::p3;
+  }
+
+  // The AOS framebuffer only holds 8-bit pixels of a complete render: parse_cli rejects the
+  // options that need float planes or write while rendering, which leaves a .pfm name.
+  if (format == ImageFormat::pfm) {
+    std::cerr << "Error: render-aos does not support PFM output\n";
+    return 1;
+  }
+  if (cam.progressive_samples > 0) {
+    std::cerr << "Error: render-aos cannot render progressive_samples\n";
+    return 1;
+  }
+
+  // implementation of the AOS rendering (one interleaved Pixel per image position)
+  std::size_t const n =
+      static_cast<std::size_t>(cam.image_width) * static_cast<std::size_t>(cam.image_height);
+  std::vector<Pixel> fb;
+  ExecutionOptions const exec{cli.threads, cli.pin, cli.numa};
+  try {
+    run_in_arena(exec, [&] {
+      RenderStats const stats = trace_rays_aos(cam, escena, fb);
+      std::cout << "Rendered (samples=" << stats.samples << ", mean spp="
+                << static_cast<double>(stats.samples) / static_cast<double>(n) << ") \n";
+      writeImage_AOS(cli.output_path, fb, cam.image_width, cam.image_height, format);
+    });
+  } catch (std::exception const & e) {
+    std::cerr << "Error: cannot write image: " << e.what() << "\n";
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,227 @@
+// Renders the same scene with the SOA and the AOS framebuffer and times each layout end to
+// end: the render into the framebuffer, then the write through the PPM writer. Both
+// layouts share the tracing core, so the difference is where pixels are stored and how
+// the writer reads them back.
+#include "camera.hpp"
+#include "config.hpp"
+#include "execution.hpp"
+#include "framebuffer_soa.hpp"
+#include "ppm_writer.hpp"
+#include "rayos.hpp"
+#include "render_scene.hpp"
+#include "scene.hpp"
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+namespace {
+
+  struct Options {
+    int reps    = 5;
+    int threads = 0;     // 0 uses every available CPU
+    std::string format;  // p3|p6; empty times both
+    std::string config_path;
+    std::string scene_path;
+    std::string output_dir;
+  };
+
+  [[noreturn]] void fail_usage(std::string_view exec_name) {
+    std::cerr << "Usage: " << exec_name
+              << " [--reps <n>] [--threads <n>] [--format p3|p6] <config.txt> <scene.txt>"
+                 " <output-dir>\n";
+    std::exit(EXIT_FAILURE);
+  }
+
+  [[noreturn]] void fail_option(std::string_view option, std::string_view text) {
+    std::cerr << "Error: Invalid " << option << " value: " << text << "\n";
+    std::exit(EXIT_FAILURE);
+  }
+
+  int parse_positive(std::string_view option, std::string_view text) {
+    int value{};
+    auto const [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (ec != std::errc{} or end != text.data() + text.size() or value <= 0) {
+      fail_option(option, text);
+    }
+    return value;
+  }
+
+  Options parse_options(std::vector<std::string_view> const & args) {
+    Options out;
+    std::vector<std::string_view> positional;
+    auto const value = [&](std::size_t & i) {
+      if (i + 1 == args.size()) {
+        fail_usage(args[0]);
+      }
+      return args[++i];
+    };
+    for (std::size_t i = 1; i < args.size(); ++i) {
+      if (args[i] == "--reps") {
+        out.reps = parse_positive("--reps", value(i));
+      } else if (args[i] == "--threads") {
+        out.threads = parse_positive("--threads", value(i));
+      } else if (args[i] == "--format") {
+        out.format = std::string(value(i));
+        if (out.format != "p3" and out.format != "p6") {
+          fail_option("--format", out.format);
+        }
+      } else {
+        positional.push_back(args[i]);
+      }
+    }
+    if (positional.size() != 3) {
+      fail_usage(args[0]);
+    }
+    out.config_path = std::string(positional[0]);
+    out.scene_path  = std::string(positional[1]);
+    out.output_dir  = std::string(positional[2]);
+    return out;
+  }
+
+  using Clock = std::chrono::steady_clock;
+
+  [[nodiscard]] double ms_between(Clock::time_point from, Clock::time_point to) {
+    return std::chrono::duration<double, std::milli>(to - from).count();
+  }
+
+  enum class Layout : std::uint8_t { soa, aos };
+
+  // Wall times of every repetition of one layout and format.
+  struct Timings {
+    std::vector<double> render;
+    std::vector<double> write;
+    std::vector<double> total;
+  };
+
+  // One render and write from an empty framebuffer, as render-soa / render-aos do it.
+  void run_once(Layout layout, Camera const & cam, RenderScene const & escena,
+                std::string const & path, ImageFormat format, Timings & out) {
+    auto const t0 = Clock::now();
+    Clock::time_point t1;
+    if (layout == Layout::soa) {
+      FramebufferSOA fb;
+      trace_rays_soa(cam, escena, fb);
+      t1 = Clock::now();
+      writeImage_SOA(path, fb, cam.image_width, cam.image_height, format);
+    } else {
+      std::vector<Pixel> fb;
+      trace_rays_aos(cam, escena, fb);
+      t1 = Clock::now();
+      writeImage_AOS(path, fb, cam.image_width, cam.image_height, format);
+    }
+    auto const t2 = Clock::now();
+    out.render.push_back(ms_between(t0, t1));
+    out.write.push_back(ms_between(t1, t2));
+    out.total.push_back(ms_between(t0, t2));
+  }
+
+  [[nodiscard]] double median(std::vector<double> values) {
+    auto const mid = values.begin() + static_cast<std::ptrdiff_t>(values.size() / 2);
+    std::nth_element(values.begin(), mid, values.end());
+    return *mid;
+  }
+
+  [[nodiscard]] double minimum(std::vector<double> const & values) {
+    return *std::min_element(values.begin(), values.end());
+  }
+
+  [[nodiscard]] std::string read_file(std::string const & path) {
+    std::ifstream in(path, std::ios::binary);
+    return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+  }
+
+  void print_row(std::string_view layout, std::string_view format, Timings const & t) {
+    std::cout << std::left << std::setw(8) << layout << std::setw(8) << format << std::right
+              << std::fixed << std::setprecision(2);
+    for (auto const * values : {&t.render, &t.write, &t.total}) {
+      std::cout << std::setw(12) << median(*values) << std::setw(10) << minimum(*values);
+    }
+    std::cout << "\n";
+  }
+
+}  // namespace
+
+int main(int argc, char * argv[]) {
+  std::vector<std::string_view> args;
+  args.reserve(static_cast<std::size_t>(argc));
+  for (int i = 0; i < argc; ++i) {
+    args.emplace_back(argv[i]);  // NOLINT
+  }
+  Options const opts = parse_options(args);
+
+  Config const cfg         = parse_config(opts.config_path);
+  Scene const scene        = parse_scene(opts.scene_path);
+  RenderScene const escena = compile_scene(scene);
+  Camera cam               = make_camera_from_config(cfg);
+  // Both layouts take the fixed-spp path; progressive passes only exist for SOA.
+  cam.progressive_samples = 0;
+  std::filesystem::create_directories(opts.output_dir);
+
+  struct FormatCase {
+    std::string_view name;
+    ImageFormat format;
+    std::string_view extension;
+  };
+
+  std::vector<FormatCase> formats;
+  if (opts.format != "p6") {
+    formats.push_back({"p3", ImageFormat::p3, ".ppm"});
+  }
+  if (opts.format != "p3") {
+    formats.push_back({"p6", ImageFormat::p6, ".pnm"});
+  }
+
+  std::cout << "Layout benchmark (" << cam.image_width << "x" << cam.image_height
+            << ", spp=" << cam.samples_per_pixel << ", reps=" << opts.reps << ")\n";
+  std::cout << std::left << std::setw(16) << "layout  format" << std::right << std::setw(22)
+            << "render med/min" << std::setw(22) << "write med/min" << std::setw(22)
+            << "total med/min" << "   (ms)\n";
+
+  bool identical = true;
+  ExecutionOptions const exec{opts.threads, false, false};
+  run_in_arena(exec, [&] {
+    // Untimed warm-up: thread start-up and the first touch of the scene are not layout
+    // costs.
+    {
+      std::vector<Pixel> fb;
+      trace_rays_aos(cam, escena, fb);
+    }
+    for (auto const & fc : formats) {
+      std::string const base = opts.output_dir + "/layout-";
+      std::array<std::string, 2> const paths{base + "soa" + std::string(fc.extension),
+                                             base + "aos" + std::string(fc.extension)};
+      std::array<Timings, 2> timings;
+      for (int rep = 0; rep < opts.reps; ++rep) {
+        // Alternate which layout goes first so neither always runs on a warmer machine.
+        std::array<Layout, 2> order{Layout::soa, Layout::aos};
+        if (rep % 2 == 1) {
+          std::swap(order[0], order[1]);
+        }
+        for (Layout const layout : order) {
+          auto const i = static_cast<std::size_t>(layout);
+          run_once(layout, cam, escena, paths.at(i), fc.format, timings.at(i));
+        }
+      }
+      print_row("soa", fc.name, timings[0]);
+      print_row("aos", fc.name, timings[1]);
+      if (read_file(paths[0]) != read_file(paths[1])) {
+        std::cerr << "Error: " << paths[0] << " and " << paths[1] << " differ\n";
+        identical = false;
+      }
+    }
+  });
+  return identical ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Axis-aligned bounding box; default-constructed boxes are empty.
+struct Aabb {
+  std::array<double, 3> lo{std::numeric_limits<double>::infinity(),
+                           std::numeric_limits<double>::infinity(),
+                           std::numeric_limits<double>::infinity()};
+  std::array<double, 3> hi{-std::numeric_limits<double>::infinity(),
+                           -std::numeric_limits<double>::infinity(),
+                           -std::numeric_limits<double>::infinity()};
+};
+
+// Deepest leaf build_bvh makes; the traversal stack holds 64 entries.
+inline constexpr std::size_t BVH_MAX_DEPTH = 60;
+
+// Flattened BVH node. Exactly one cache line: children of an interior node are
+// laid out depth-first, so the first child is always the next node in the array.
+// A leaf keeps its spheres and its cylinders as two separate runs so the intersection
+// kernels can test each run as a block.
+struct alignas(64) BvhNode {
+  std::array<double, 3> lo{};
+  std::array<double, 3> hi{};
+  std::uint32_t offset{};      // leaf: first slot in sphere_ids; interior: index of second child
+  std::uint32_t cyl_offset{};  // leaf: first slot in cylinder_ids
+  std::uint16_t count{};       // leaf: number of spheres
+  std::uint16_t cyl_count{};   // leaf: number of cylinders
+  std::uint16_t axis{};        // interior: split axis, used to visit the near child first
+
+  [[nodiscard]] bool is_leaf() const { return count + cyl_count > 0; }
+};
+
+// Primitive ids follow the brute-force visiting order: [0, num_spheres) are
+// sphere indices, the rest are num_spheres + cylinder index. The slot arrays list
+// the original sphere / cylinder index of every leaf entry, in leaf order.
+struct Bvh {
+  std::vector<BvhNode> nodes;
+  std::vector<std::uint32_t> sphere_ids;
+  std::vector<std::uint32_t> cylinder_ids;
+  std::uint32_t num_spheres{};
+};
+
+// Builds the hierarchy with the surface area heuristic over one box per primitive id.
+// An empty box list gives an empty tree.
+Bvh build_bvh(std::vector<Aabb> const & bounds, std::uint32_t num_spheres);
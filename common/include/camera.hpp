@@ -1,7 +1,10 @@
 #pragma once
 #include "config.hpp"  // uses your parsed config
+#include "sampler.hpp"
+#include "tiles.hpp"
 #include <array>
 #include <cstdint>
+#include <vector>
 
 struct Camera {
   // Inputs (copied from config)
@@ -27,6 +30,19 @@ struct Camera {
   double gamma{};
   int samples_per_pixel{};
   int max_depth{};
+  double throughput_threshold{};
+  int russian_roulette_depth{};
+  int adaptive_max_samples{};
+  int adaptive_min_samples{};
+  double adaptive_error{};
+  int progressive_samples{};
+  double progressive_interval{};
+  int tile_size{};
+  TileOrder tile_order{};
+  // Seconds per tile, in tile_order, measured by an earlier render (--tile-costs). With
+  // them tiles are handed out longest first; empty keeps the curve order.
+  std::vector<double> tile_costs{};
+  SamplerType sampler{};
   std::uint64_t material_rng_seed{};
   std::uint64_t ray_rng_seed{};
 };
@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -7,7 +8,24 @@ struct CLIArgs {
   std::string config_path;
   std::string scene_path;
   std::string output_path;
+  double time_budget = 0.0;     // --time-budget <seconds>; 0 renders samples_per_pixel
+  int tile_size      = 0;       // --tile-size <pixels>; 0 keeps the config value
+  std::string tile_costs_path;  // --tile-costs <file.csv>; read to order tiles, then rewritten
+  int threads     = 0;          // --threads <n>; 0 uses every available CPU
+  bool pin        = false;      // --pin: one CPU per render thread
+  bool numa       = false;      // --numa: interleave the scene across NUMA nodes
+  bool huge_pages = false;      // --huge-pages: back large framebuffer planes with huge pages
+  std::string format;           // --format p3|p6|pfm; empty picks it from the output extension
+  std::string pfm_path;         // --pfm <file.pfm>; also write the linear image there
+  bool mmap        = false;     // --mmap: render straight into a memory-mapped P6 file
+  int stream_bands = 0;         // --stream <bands>: render in bands, at most this many in memory
+  bool scene_cache = true;      // --no-scene-cache: always parse and compile the scene text
 };
 
+// Framebuffer layout of the executable. render-aos keeps 8-bit pixels of a complete render
+// only: its usage leaves out, and parse_cli rejects, the options that need the SOA planes.
+enum class CliLayout : std::uint8_t { soa, aos };
+
 // No C-style arrays in the interface; vector<string_view> is fine for clang-tidy.
-CLIArgs parse_cli(std::vector<std::string_view> const & args, std::string_view exec_name);
+CLIArgs parse_cli(std::vector<std::string_view> const & args, std::string_view exec_name,
+                  CliLayout layout = CliLayout::soa);
@@ -1,4 +1,6 @@
 #pragma once
+#include "sampler.hpp"
+#include "tiles.hpp"
 #include <array>
 #include <string_view>
 
@@ -19,6 +21,36 @@ struct Config {
   int samples_per_pixel = 20;
   int max_depth         = 5;
 
+  // Path termination. A path stops once no channel of its throughput exceeds
+  // throughput_threshold (0 only drops paths that can no longer add light, which is
+  // unbiased). With russian_roulette_depth > 0, from that bounce on paths survive with
+  // probability max(throughput) and are reweighted, which is also unbiased.
+  double throughput_threshold = 0.0;
+  int russian_roulette_depth  = 0;
+
+  // Adaptive sampling (adaptive_max_samples = 0 keeps a fixed samples_per_pixel). When on,
+  // samples_per_pixel is the average budget per pixel: every pixel takes
+  // adaptive_min_samples, then pixels whose 95% confidence interval on luminance is wider
+  // than adaptive_error times their mean keep sampling, up to adaptive_max_samples each.
+  int adaptive_max_samples = 0;
+  int adaptive_min_samples = 8;
+  double adaptive_error    = 0.02;
+
+  // Progressive rendering (progressive_samples = 0 renders in one go). The frame is
+  // rendered in passes of progressive_samples spp, and a preview of the output image is
+  // written after a pass once progressive_interval seconds (0 = every pass) have elapsed
+  // since the previous one.
+  int progressive_samples     = 0;
+  double progressive_interval = 0.0;
+
+  // Tile scheduling: square tiles of tile_size pixels handed out along tile_order
+  // (scanline, morton or hilbert). --tile-size on the command line overrides the size.
+  int tile_size        = 16;
+  TileOrder tile_order = TileOrder::hilbert;
+
+  // Source of the pixel jitter and bounce numbers: random, stratified or sobol.
+  SamplerType sampler = SamplerType::random;
+
   // RNG seeds (must be > 0 when we validate later)
   int material_rng_seed = 1;
   int ray_rng_seed      = 1;
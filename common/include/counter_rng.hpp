@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+
+// What the numbers are drawn for. Each stream is keyed apart, so a ray and a material
+// generator built from equal seeds still draw unrelated numbers.
+enum class RngStream : std::uint8_t { ray, material };
+
+// Stateless counter-based generator. Every draw is a hash of (seed, stream, pixel, sample,
+// bounce, draw index), so the numbers a path sees never depend on which thread ran it
+// or in what order: renders are reproducible for any thread count and any schedule.
+class CounterRng {
+public:
+  CounterRng(std::uint64_t seed, RngStream stream, std::uint64_t pixel, std::uint64_t sample)
+      : key_(mix(mix(mix(seed ^ SALT_SEED ^ stream_salt(stream)) ^ pixel) ^
+                 (sample * SALT_SAMPLE))) { }
+
+  // Starts the numbers of another bounce; draws within a bounce restart at 0.
+  void set_bounce(std::uint32_t bounce) {
+    bounce_  = bounce;
+    counter_ = 0;
+  }
+
+  [[nodiscard]] std::uint64_t next_u64() {
+    std::uint64_t const ctr = (std::uint64_t{bounce_} << 32U) | counter_++;
+    return mix(key_ ^ mix(ctr));
+  }
+
+  // Uniform in [0, 1) with 53 random bits.
+  [[nodiscard]] double next_double() {
+    return static_cast<double>(next_u64() >> 11U) * 0x1.0p-53;
+  }
+
+  // Uniform in [lo, hi).
+  [[nodiscard]] double uniform(double lo, double hi) { return lo + (hi - lo) * next_double(); }
+
+  // SplitMix64 finaliser: a bijective 64-bit mixer with full avalanche.
+  [[nodiscard]] static constexpr std::uint64_t mix(std::uint64_t z) {
+    z = (z ^ (z >> 30U)) * 0xBF58'476D'1CE4'E5B9ULL;
+    z = (z ^ (z >> 27U)) * 0x94D0'49BB'1331'11EBULL;
+    return z ^ (z >> 31U);
+  }
+
+  // Mixed into a seed to key one stream; 0 for the ray stream, which keeps its old numbers.
+  [[nodiscard]] static constexpr std::uint64_t stream_salt(RngStream stream) {
+    return static_cast<std::uint64_t>(stream) * SALT_STREAM;
+  }
+
+private:
+  static constexpr std::uint64_t SALT_SEED   = 0x9E37'79B9'7F4A'7C15ULL;
+  static constexpr std::uint64_t SALT_SAMPLE = 0xD1B5'4A32'D192'ED03ULL;
+  static constexpr std::uint64_t SALT_STREAM = 0xA076'1D64'78BD'642FULL;
+
+  std::uint64_t key_;
+  std::uint32_t bounce_  = 0;
+  std::uint32_t counter_ = 0;
+};
@@ -0,0 +1,27 @@
+#pragma once
+#include <functional>
+
+// Where and how wide a render runs. The defaults leave everything to TBB and the OS.
+struct ExecutionOptions {
+  int threads = 0;      // arena size; 0 = one per available CPU
+  bool pin    = false;  // pin each arena thread to one CPU of the process mask
+  bool numa   = false;  // interleave the compiled scene across NUMA nodes
+};
+
+// Runs fn inside a tbb::task_arena sized and pinned as requested, so nested TBB work
+// (the whole render) stays within the arena.
+void run_in_arena(ExecutionOptions const & opts, std::function<void()> const & fn);
+
+// While alive, and only if enabled, pages first touched by this thread are interleaved
+// across all NUMA nodes. Used for the read-only scene that every render thread reads, so
+// no single socket serves all of it. A no-op on systems without NUMA support.
+class ScopedNumaInterleave {
+public:
+  explicit ScopedNumaInterleave(bool enabled);
+  ~ScopedNumaInterleave();
+  ScopedNumaInterleave(ScopedNumaInterleave const &)             = delete;
+  ScopedNumaInterleave & operator=(ScopedNumaInterleave const &) = delete;
+
+private:
+  bool active_ = false;
+};
@@ -0,0 +1,177 @@
+#pragma once
+#include "tiles.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+#include <vector>
+#if __has_include(<mdspan>)
+#include <mdspan>
+#endif
+
+// alineacion de todos los planos: una linea de cache, y el ancho de un vector AVX-512
+inline constexpr std::size_t ALINEACION_PLANO = 64;
+
+// las reservas de al menos este tamanyo se alinean a 2 MiB, el tamanyo de una pagina
+// enorme, para que setHugePagesSOA pueda pedirlas al sistema
+inline constexpr std::size_t TAM_PAGINA_ENORME = std::size_t{2} << 20U;
+
+// con true, los planos de TAM_PAGINA_ENORME o mas se marcan para paginas enormes
+// transparentes (solo Linux; en otros sistemas no hace nada)
+void setHugePagesSOA(bool activar);
+
+// memoria alineada de un plano: ALINEACION_PLANO bytes (TAM_PAGINA_ENORME si es grande),
+// con el tamanyo redondeado a lineas completas para que una carga vectorial al final del
+// plano no salga de la reserva
+[[nodiscard]] void * reservarPlanoSOA(std::size_t bytes);
+void liberarPlanoSOA(void * datos, std::size_t bytes) noexcept;
+
+// asignador de los planos: memoria de reservarPlanoSOA, y resize() deja los elementos
+// nuevos sin inicializar, de modo que las paginas las toca primero el hilo de render que
+// las escribe (y quedan en su nodo NUMA), no el hilo que reserva rellenandolas de ceros
+template <typename T>
+struct PlanoAllocator {
+  using value_type = T;
+
+  PlanoAllocator() = default;
+
+  template <typename U>
+  explicit(false) PlanoAllocator(PlanoAllocator<U> const &) noexcept { }
+
+  [[nodiscard]] T * allocate(std::size_t n) {
+    return static_cast<T *>(reservarPlanoSOA(n * sizeof(T)));
+  }
+
+  void deallocate(T * datos, std::size_t n) noexcept { liberarPlanoSOA(datos, n * sizeof(T)); }
+
+  template <typename U>
+  void construct(U * p) noexcept {
+    ::new (static_cast<void *>(p)) U;
+  }
+
+  template <typename U, typename... Args>
+  void construct(U * p, Args &&... args) {
+    ::new (static_cast<void *>(p)) U(std::forward<Args>(args)...);
+  }
+
+  template <typename U>
+  [[nodiscard]] bool operator==(PlanoAllocator<U> const &) const noexcept {
+    return true;
+  }
+};
+
+// plano de un canal; ver PlanoAllocator
+using PlanoSOA      = std::vector<std::uint8_t, PlanoAllocator<std::uint8_t>>;
+using PlanoFloatSOA = std::vector<float, PlanoAllocator<float>>;
+
+// paso de fila de los planos float: el ancho redondeado a lineas de cache completas
+[[nodiscard]] inline std::size_t pasoLinealSOA(std::size_t ancho) noexcept {
+  constexpr std::size_t por_linea = ALINEACION_PLANO / sizeof(float);
+  return (ancho + por_linea - 1) / por_linea * por_linea;
+}
+
+// estructura SOA para framebuffer: el color final en 8 bits por canal y, junto a el, el
+// color lineal en float (vacio si no se usa). Mientras dura un render progresivo los planos
+// float llevan sumas de muestras; al acabar cualquier render que los tenga, la media de
+// cada pixel sin recortar ni corregir gamma. Sus filas empiezan en linea de cache (paso
+// pasoLineal), asi que con teselas de ancho multiplo de 16 dos hilos nunca escriben en la
+// misma linea
+struct FramebufferSOA {
+  PlanoSOA R;
+  PlanoSOA G;
+  PlanoSOA B;
+  PlanoFloatSOA linealR;
+  PlanoFloatSOA linealG;
+  PlanoFloatSOA linealB;
+  std::size_t pasoLineal = 0;
+};
+
+// estructura para valores RGB de un pixel
+struct PixelRGB {
+  std::uint8_t r;
+  std::uint8_t g;
+  std::uint8_t b;
+};
+
+// dimensiona framebuffer SOA (sin inicializar; el render escribe todos los pixeles)
+inline void initFramebufferSOA(FramebufferSOA & fb, int ancho, int alto) {
+  std::size_t const n = static_cast<std::size_t>(ancho) * static_cast<std::size_t>(alto);
+  fb.R.resize(n);
+  fb.G.resize(n);
+  fb.B.resize(n);
+}
+
+// dimensiona los planos float (sin inicializar; el render los escribe todos)
+inline void initLinealSOA(FramebufferSOA & fb, int ancho, int alto) {
+  fb.pasoLineal       = pasoLinealSOA(static_cast<std::size_t>(ancho));
+  std::size_t const n = fb.pasoLineal * static_cast<std::size_t>(alto);
+  fb.linealR.resize(n);
+  fb.linealG.resize(n);
+  fb.linealB.resize(n);
+}
+
+// calcula indice lineal desde coordenadas 2D para acceso SOA
+[[nodiscard]] inline std::size_t idxSOA(std::size_t x, std::size_t y, std::size_t ancho) noexcept {
+  return y * ancho + x;
+}
+
+// almacena valores RGB de pixel en SOA usando indice precalculado
+inline void storePixelSOA(FramebufferSOA & fb, std::size_t idx, PixelRGB rgb) {
+  fb.R[idx] = rgb.r;
+  fb.G[idx] = rgb.g;
+  fb.B[idx] = rgb.b;
+}
+
+// ---------- vistas de tesela ----------
+
+#if defined(__cpp_lib_mdspan)
+// vista 2D [fila, col] de una tesela dentro de un plano
+template <typename T>
+using VistaTesela = std::mdspan<T, std::dextents<std::size_t, 2>, std::layout_stride>;
+
+template <typename T>
+[[nodiscard]] VistaTesela<T> hacerVistaTesela(T * datos, std::size_t filas, std::size_t cols,
+                                              std::size_t paso) {
+  using Extents = std::dextents<std::size_t, 2>;
+  return {datos, std::layout_stride::mapping<Extents>(Extents(filas, cols),
+                                                      std::array<std::size_t, 2>{paso, 1})};
+}
+#else
+// sustituto minimo de std::mdspan con layout_stride, para bibliotecas que aun no lo traen
+template <typename T>
+class VistaTesela {
+public:
+  VistaTesela(T * datos, std::size_t filas, std::size_t cols, std::size_t paso) noexcept
+      : datos_(datos), extensiones_{filas, cols}, paso_(paso) { }
+
+  [[nodiscard]] T & operator[](std::size_t fila, std::size_t col) const noexcept {
+    return datos_[fila * paso_ + col];  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  }
+
+  [[nodiscard]] std::size_t extent(std::size_t r) const noexcept { return extensiones_.at(r); }
+
+  [[nodiscard]] std::size_t stride(std::size_t r) const noexcept { return r == 0 ? paso_ : 1; }
+
+  [[nodiscard]] T * data_handle() const noexcept { return datos_; }
+
+private:
+  T * datos_;
+  std::array<std::size_t, 2> extensiones_;
+  std::size_t paso_;
+};
+
+template <typename T>
+[[nodiscard]] VistaTesela<T> hacerVistaTesela(T * datos, std::size_t filas, std::size_t cols,
+                                              std::size_t paso) {
+  return {datos, filas, cols, paso};
+}
+#endif
+
+// vista de la tesela t en un plano con filas de 'paso' elementos
+template <typename T, typename A>
+[[nodiscard]] VistaTesela<T> vistaTesela(std::vector<T, A> & plano, std::size_t paso,
+                                         Tile const & t) {
+  return hacerVistaTesela(plano.data() + t.y0 * paso + t.x0, std::size_t(t.y1 - t.y0),
+                          std::size_t(t.x1 - t.x0), paso);
+}
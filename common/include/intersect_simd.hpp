@@ -0,0 +1,70 @@
+#pragma once
+#include <cstdint>
+
+// Thresholds shared by the scalar intersection code and the SIMD kernels.
+inline constexpr double HIT_EPSILON   = 1e-3;  // minimum accepted ray distance
+inline constexpr double DENOM_EPSILON = 1e-8;  // parallel ray / degenerate quadratic
+
+// Plain views for the SIMD kernels. The kernels are compiled with per-file ISA flags,
+// so their interface avoids std containers whose inline members the linker could pick
+// from an AVX-512 object for use on any CPU.
+struct SimdRay {
+  double ox, oy, oz;
+  double dx, dy, dz;
+};
+
+struct SphereView {
+  double const * cx;
+  double const * cy;
+  double const * cz;
+  double const * r2;
+  std::uint32_t const * id;
+};
+
+struct CylinderView {
+  double const * cx;
+  double const * cy;
+  double const * cz;
+  double const * ax;
+  double const * ay;
+  double const * az;
+  double const * lox;
+  double const * loy;
+  double const * loz;
+  double const * hix;
+  double const * hiy;
+  double const * hiz;
+  double const * half_height;
+  double const * radius;
+  double const * r2;
+  std::uint32_t const * id;
+};
+
+// Closest hit found so far: distance, brute-force id (breaks ties) and BVH slot.
+struct HitCandidate {
+  double t;
+  std::uint32_t id;
+  std::uint32_t slot;
+};
+
+// Each kernel tests slots [begin, begin + count) and replaces `best` with any primitive
+// whose (t, id) is smaller. Distances are computed with exactly the operations of the
+// scalar intersection code, so every ISA selects the same primitive.
+using SphereKernel   = void (*)(SimdRay const & ray, SphereView const & spheres,
+                              std::uint32_t begin, std::uint32_t count, HitCandidate & best);
+using CylinderKernel = void (*)(SimdRay const & ray, CylinderView const & cylinders,
+                                std::uint32_t begin, std::uint32_t count, HitCandidate & best);
+
+struct IntersectKernels {
+  SphereKernel spheres;
+  CylinderKernel cylinders;
+  char const * name;
+};
+
+// Widest implementation the running CPU supports: AVX-512, AVX2 or scalar.
+IntersectKernels const & intersect_kernels();
+
+// Every implementation the running CPU supports, scalar at index 0 and the widest last,
+// so that tests and benchmarks can run each of them.
+std::uint32_t num_intersect_kernels();
+IntersectKernels const & intersect_kernels(std::uint32_t index);
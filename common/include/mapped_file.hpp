@@ -0,0 +1,39 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// How the caller will read a mapped file; picks the read-ahead advice for the mapping.
+enum class FileAccess : std::uint8_t {
+  sequential,  // front to back once
+  whole,       // all of it, in any order: fault the file in up front
+};
+
+// Read-only view of a whole file. Regular files are memory-mapped; anything mmap refuses
+// (pipes, character devices) is read into memory instead. Throws std::runtime_error if
+// the file cannot be opened or read.
+class MappedFile {
+public:
+  explicit MappedFile(std::string const & path, FileAccess access = FileAccess::sequential);
+  ~MappedFile();
+  MappedFile(MappedFile const &)             = delete;
+  MappedFile & operator=(MappedFile const &) = delete;
+  MappedFile(MappedFile &&)                  = delete;
+  MappedFile & operator=(MappedFile &&)      = delete;
+
+  [[nodiscard]] char const * data() const { return data_; }
+
+  [[nodiscard]] std::size_t size() const { return size_; }
+
+  [[nodiscard]] std::string_view text() const { return {data_, size_}; }
+
+  // True if data() is a page-aligned mapping rather than a copy of the contents.
+  [[nodiscard]] bool mapped() const { return mapped_; }
+
+private:
+  char const * data_ = nullptr;
+  std::size_t size_  = 0;
+  bool mapped_       = false;
+  std::string buffer_;  // contents when the file could not be mapped
+};
@@ -1,8 +1,92 @@
 #pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
 #include <string>
+#include <vector>
 
 struct Pixel;           // AOS
 struct FramebufferSOA;  // SOA
 
+// formato del archivo de salida; pfm guarda el color lineal en float (Portable Float Map)
+enum class ImageFormat : std::uint8_t { p3, p6, pfm };
+
+// formato segun la extension: ".pnm" -> P6 binario, ".pfm" -> PFM, cualquier otra
+// (".ppm") -> P3
+[[nodiscard]] ImageFormat image_format_from_path(std::string const & ruta);
+
 // escribe framebuffer SOA a archivo PPM en formato P3
 bool writePPM_SOA(std::string const & ruta, FramebufferSOA const & fb, int ancho, int alto);
+
+// escribe framebuffer SOA a archivo PPM binario (P6)
+bool writePPM_P6_SOA(std::string const & ruta, FramebufferSOA const & fb, int ancho, int alto);
+
+// escribe los planos float (color lineal) del framebuffer SOA a archivo PFM en color,
+// en el orden de bytes de la maquina; lanza si el framebuffer no tiene planos float
+bool writePFM_SOA(std::string const & ruta, FramebufferSOA const & fb, int ancho, int alto);
+
+// lee un PFM en color (cabecera "PF") a los planos float de fb, en cualquier orden de
+// bytes; lanza si el archivo no es un PFM valido
+void readPFM_SOA(std::string const & ruta, FramebufferSOA & fb, int & ancho, int & alto);
+
+// escribe framebuffer SOA en el formato pedido
+bool writeImage_SOA(std::string const & ruta, FramebufferSOA const & fb, int ancho, int alto,
+                    ImageFormat formato);
+
+// escribe framebuffer AOS a archivo PPM en formato P3
+bool writePPM_AOS(std::string const & ruta, std::vector<Pixel> const & fb, int ancho, int alto);
+
+// escribe framebuffer AOS a archivo PPM binario (P6)
+bool writePPM_P6_AOS(std::string const & ruta, std::vector<Pixel> const & fb, int ancho,
+                     int alto);
+
+// escribe framebuffer AOS en el formato pedido; lanza para pfm, AOS no guarda color lineal
+bool writeImage_AOS(std::string const & ruta, std::vector<Pixel> const & fb, int ancho,
+                    int alto, ImageFormat formato);
+
+// escribe una imagen por bandas de filas completas, de arriba abajo, sin tenerla entera en
+// memoria; el encabezado sale al crearlo
+class BandWriter {
+public:
+  BandWriter(std::string const & ruta, int ancho, int alto, ImageFormat formato);
+  ~BandWriter();
+  BandWriter(BandWriter const &)             = delete;
+  BandWriter & operator=(BandWriter const &) = delete;
+  BandWriter(BandWriter &&)                  = delete;
+  BandWriter & operator=(BandWriter &&)      = delete;
+
+  // anyade las filas de la banda (banda.R.size() / ancho)
+  void write(FramebufferSOA const & banda);
+
+  // cierra el archivo; lanza si fclose falla (p. ej. al volcar el ultimo bufer al disco)
+  void close();
+
+private:
+  std::FILE * archivo_ = nullptr;
+  std::size_t ancho_   = 0;
+  ImageFormat formato_;
+};
+
+// archivo P6 creado con su tamanyo final y proyectado en memoria: el encabezado ya esta
+// escrito y el render escribe cada pixel directamente en su posicion de pixels() (RGB
+// entrelazado, fila a fila), sin framebuffer intermedio ni bucle de escritura al final
+class MappedP6Image {
+public:
+  MappedP6Image(std::string const & ruta, int ancho, int alto);
+  ~MappedP6Image();
+  MappedP6Image(MappedP6Image const &)             = delete;
+  MappedP6Image & operator=(MappedP6Image const &) = delete;
+  MappedP6Image(MappedP6Image &&)                  = delete;
+  MappedP6Image & operator=(MappedP6Image &&)      = delete;
+
+  [[nodiscard]] std::uint8_t * pixels() const { return datos_ + cabecera_; }
+
+  // deshace la proyeccion y cierra el archivo; lanza si el sistema informa de un error
+  void close();
+
+private:
+  std::uint8_t * datos_ = nullptr;
+  std::size_t tamanyo_  = 0;
+  std::size_t cabecera_ = 0;
+  int fd_               = -1;
+};
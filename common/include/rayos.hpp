@@ -1,13 +1,17 @@
 #ifndef RAYOS_HPP
 #define RAYOS_HPP
 
-#include "../../soa/src/framebuffer_soa.hpp"
+#include "framebuffer_soa.hpp"
+#include "tiles.hpp"
 #include <array>
+#include <chrono>
 #include <cstdint>
+#include <functional>
 #include <vector>
 
 struct Camera;
-struct Scene;
+struct IntersectKernels;
+struct RenderScene;
 
 struct Pixel {
   std::uint8_t r;
@@ -28,8 +32,69 @@ struct HitRecord {
   std::uint32_t material_id    = 0;
 };
 
-void trace_rays_aos(Camera const & camara, Scene const & escena, std::vector<Pixel> & framebuffer);
+struct TileCost {
+  Tile tile;
+  double seconds;  // wall time spent on the tile, summed over passes
+};
+
+// Work done by a render, for reporting.
+struct RenderStats {
+  std::uint64_t samples;        // camera samples traced over the whole image
+  std::vector<TileCost> tiles;  // in tile_order; empty for adaptive and streaming
+};
+
+// Called after every progressive pass with the image of all samples so far. Returning
+// false stops the render at that pass boundary.
+using PassCallback = std::function<bool(FramebufferSOA const &, RenderStats const &)>;
+
+// Called with each finished band of a streaming render, top to bottom: band holds whole
+// rows starting at first_row.
+using BandCallback = std::function<void(FramebufferSOA const & band, int first_row)>;
+
+// If the framebuffer has float planes (initLinealSOA), they also get the linear mean of
+// every pixel, unclamped and without gamma.
+RenderStats trace_rays_soa(Camera const & camara, RenderScene const & escena,
+                           FramebufferSOA & framebuffer);
+
+// Same render as trace_rays_soa, but every finished pixel goes straight to rgb as three
+// interleaved bytes at offset 3 * (row * width + col), e.g. the pixel area of a
+// MappedP6Image. rgb must hold 3 * image_width * image_height bytes.
+RenderStats trace_rays_rgb(Camera const & camara, RenderScene const & escena,
+                           std::uint8_t * rgb);
+
+// Same render as trace_rays_soa into an interleaved array of pixels, resized to
+// image_width * image_height.
+RenderStats trace_rays_aos(Camera const & camara, RenderScene const & escena,
+                           std::vector<Pixel> & framebuffer);
+
+// Renders samples_per_pixel in passes of progressive_samples spp, accumulating into the
+// framebuffer's float planes, which hold the linear mean when it returns. The final image
+// matches trace_rays_soa up to float rounding.
+RenderStats trace_rays_progressive(Camera const & camara, RenderScene const & escena,
+                                   FramebufferSOA & framebuffer, PassCallback const & on_pass);
+
+// Samples the whole frame one spp at a time until the deadline, ignoring
+// samples_per_pixel. Rows not started by the deadline are skipped, so the render stops
+// within one row of it; the first pass is always completed. The float planes end up with
+// the linear mean, as in trace_rays_progressive.
+RenderStats trace_rays_until(Camera const & camara, RenderScene const & escena,
+                             FramebufferSOA & framebuffer,
+                             std::chrono::steady_clock::time_point deadline);
+
+// Renders samples_per_pixel in bands of tile_size rows and hands each band to on_band as
+// soon as it and every band above it are done. At most max_bands bands are in memory at
+// once, whatever the image height; pixels match trace_rays_soa.
+RenderStats trace_rays_streaming(Camera const & camara, RenderScene const & escena,
+                                 int max_bands, BandCallback const & on_band);
+
+// Closest hit of the ray, found through the BVH with the given kernels (see
+// intersect_simd.hpp). A miss returns the default HitRecord.
+HitRecord closest_hit(Ray const & rayo, RenderScene const & escena,
+                      IntersectKernels const & kernels);
 
-void trace_rays_soa(Camera const & camara, Scene const & escena, FramebufferSOA & framebuffer);
+// Reference for closest_hit: every sphere and then every cylinder in id order, with the
+// scalar intersection code and no BVH. On equal distance the lower id wins, as in the
+// kernels, so both return the same record.
+HitRecord closest_hit_linear(Ray const & rayo, RenderScene const & escena);
 
 #endif  // RAYOS_HPP
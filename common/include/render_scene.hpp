@@ -0,0 +1,177 @@
+#pragma once
+#include "bvh.hpp"
+#include "scene.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <vector>
+
+// Widest SIMD block the intersection kernels load (AVX-512, 8 doubles). Every primitive
+// array carries this many inert slots at the end so a full-width load at any leaf
+// never reads past the allocation.
+inline constexpr std::size_t SIMD_PADDING = 8;
+
+// ---------- Compiled materials ----------
+// Primitives name their material by a reference: the MaterialType in the top two bits,
+// the index into RenderScene::materials below. Shading picks the code path from the
+// reference alone, so the table entries only hold parameters.
+
+inline constexpr unsigned MATERIAL_TYPE_SHIFT       = 30;
+inline constexpr std::uint32_t MATERIAL_INDEX_MASK = (std::uint32_t{1} << MATERIAL_TYPE_SHIFT) - 1;
+
+[[nodiscard]] constexpr std::uint32_t material_ref(MaterialType type, std::uint32_t index) {
+  return (static_cast<std::uint32_t>(type) << MATERIAL_TYPE_SHIFT) | index;
+}
+
+[[nodiscard]] constexpr MaterialType material_type(std::uint32_t ref) {
+  return static_cast<MaterialType>(ref >> MATERIAL_TYPE_SHIFT);
+}
+
+[[nodiscard]] constexpr std::uint32_t material_index(std::uint32_t ref) {
+  return ref & MATERIAL_INDEX_MASK;
+}
+
+// What ray_color reads per bounce: two entries per cache line, no name, and one slot
+// shared by the parameters of whichever type the reference says.
+struct alignas(32) RenderMaterial {
+  std::array<double, 3> rgb{};  // Matte, Metal: attenuation
+  double param{};               // Metal: diffusion; Refractive: index
+
+  [[nodiscard]] double diffusion() const { return param; }
+
+  [[nodiscard]] double index() const { return param; }
+};
+
+static_assert(sizeof(RenderMaterial) == 32);
+
+// Material names, kept out of the hot table for diagnostics: name i is
+// chars[offsets[i], offsets[i + 1]).
+struct MaterialNames {
+  std::span<std::uint64_t const> offsets;  // one more than there are materials
+  std::span<char const> chars;
+
+  [[nodiscard]] std::string_view get(std::size_t i) const {
+    return {chars.data() + offsets[i], offsets[i + 1] - offsets[i]};
+  }
+};
+
+// ---------- Compiled primitives ----------
+// Everything the intersection loop needs, computed once per scene.
+
+struct RenderSphere {
+  std::array<double, 3> center{};
+  double radius2{};
+  std::uint32_t material_id{};  // material_ref()
+};
+
+struct RenderCylinder {
+  std::array<double, 3> center{};     // middle of the cylinder (Cylinder::base_center)
+  std::array<double, 3> axis{};       // unit axis
+  std::array<double, 3> cap_lo{};     // centre of the cap at -axis
+  std::array<double, 3> cap_hi{};     // centre of the cap at +axis
+  std::array<double, 3> normal_lo{};  // -axis, outward normal of cap_lo
+  double half_height{};
+  double radius{};
+  double radius2{};
+  std::uint32_t material_id{};  // material_ref()
+};
+
+// The arrays below are read-only views into RenderScene::storage.
+
+// Spheres in BVH slot order (see Bvh::sphere_ids), one array per component.
+struct SphereSoA {
+  std::span<double const> cx, cy, cz;
+  std::span<double const> r2;
+  std::span<std::uint32_t const> material_id;
+  std::span<std::uint32_t const> id;  // brute-force order, breaks distance ties
+
+  [[nodiscard]] RenderSphere get(std::size_t slot) const {
+    return {
+      {cx[slot], cy[slot], cz[slot]},
+      r2[slot], material_id[slot]
+    };
+  }
+};
+
+// Cylinders in BVH slot order (see Bvh::cylinder_ids), one array per component.
+struct CylinderSoA {
+  std::span<double const> cx, cy, cz;     // centre
+  std::span<double const> ax, ay, az;     // unit axis
+  std::span<double const> lox, loy, loz;  // cap at -axis
+  std::span<double const> hix, hiy, hiz;  // cap at +axis
+  std::span<double const> half_height;
+  std::span<double const> radius;
+  std::span<double const> r2;
+  std::span<std::uint32_t const> material_id;
+  std::span<std::uint32_t const> id;  // brute-force order, breaks distance ties
+
+  [[nodiscard]] RenderCylinder get(std::size_t slot) const {
+    return {
+      {cx[slot], cy[slot], cz[slot]},
+      {ax[slot], ay[slot], az[slot]},
+      {lox[slot], loy[slot], loz[slot]},
+      {hix[slot], hiy[slot], hiz[slot]},
+      {-ax[slot], -ay[slot], -az[slot]},
+      half_height[slot], radius[slot], r2[slot], material_id[slot]
+    };
+  }
+};
+
+// The part of a Bvh the traversal reads; the slot id arrays are already folded into the
+// primitive arrays.
+struct BvhView {
+  std::span<BvhNode const> nodes;
+  std::uint32_t num_spheres{};
+};
+
+// ---------- Render scene ----------
+// Read-only once built; the renderer never looks at the parsed Scene. Copies share the
+// same arrays.
+struct RenderScene {
+  std::span<RenderMaterial const> materials;  // indexed by material_index()
+  MaterialNames material_names;
+  SphereSoA spheres;
+  CylinderSoA cylinders;
+  std::span<Aabb const> bounds;  // one per BVH primitive id
+  BvhView bvh;
+  // Keeps the viewed arrays alive: the vectors compile_scene built, or a mapped cache file
+  // (see scene_cache.hpp).
+  std::shared_ptr<void const> storage;
+
+  [[nodiscard]] std::size_t num_spheres() const { return bvh.num_spheres; }
+
+  [[nodiscard]] std::size_t num_cylinders() const { return bounds.size() - bvh.num_spheres; }
+};
+
+// Calls f on every array view of the scene, always in the same order. The scene cache
+// writes and maps the arrays in this order.
+template <typename Views, typename F>
+void for_each_array(Views & rs, F && f) {
+  auto & s = rs.spheres;
+  auto & c = rs.cylinders;
+  for (auto * array : {&s.cx, &s.cy, &s.cz, &s.r2}) {
+    f(*array);
+  }
+  f(s.material_id);
+  f(s.id);
+  for (auto * array : {&c.cx, &c.cy, &c.cz, &c.ax, &c.ay, &c.az, &c.lox, &c.loy, &c.loz, &c.hix,
+                       &c.hiy, &c.hiz, &c.half_height, &c.radius, &c.r2}) {
+    f(*array);
+  }
+  f(c.material_id);
+  f(c.id);
+  f(rs.bounds);
+  f(rs.bvh.nodes);
+  f(rs.materials);
+  f(rs.material_names.offsets);
+  f(rs.material_names.chars);
+}
+
+RenderScene compile_scene(Scene const & scene);
+
+// Copy of rs whose arrays live in one freshly allocated block, written (first touched) by
+// the calling thread, so its memory policy decides where the pages go.
+RenderScene copy_render_scene(RenderScene const & rs);
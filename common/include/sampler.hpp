@@ -0,0 +1,151 @@
+#pragma once
+#include "counter_rng.hpp"
+#include <cmath>
+#include <cstdint>
+
+enum class SamplerType : std::uint8_t { random, stratified, sobol };
+
+// Sample values for one camera sample of one pixel, indexed by (seed, stream, pixel,
+// sample, dimension). Each bounce owns DIMS_PER_BOUNCE dimensions, consumed in order by
+// next_double(); dimensions are grouped in pairs so 2D draws stay well distributed.
+//
+//   random      independent uniform numbers from CounterRng (same stream as before)
+//   stratified  each dimension pair is a jittered grid over sample_count strata, visited
+//               in a per-pixel random order
+//   sobol       each dimension pair is a 2D Sobol' point set with hash-based Owen
+//               scrambling and a shuffled sample index (Burley 2020), so pairs stay
+//               decorrelated without a high-dimensional Sobol' table
+//
+// Draws past a bounce's block (or past MAX_BOUNCES) fall back to random numbers.
+class Sampler {
+public:
+  static constexpr std::uint32_t DIMS_PER_BOUNCE = 4;
+  static constexpr std::uint32_t MAX_BOUNCES     = 64;
+
+  Sampler(SamplerType type, std::uint64_t seed, RngStream stream, std::uint64_t pixel,
+          std::uint32_t sample, std::uint32_t sample_count)
+      : rng_(seed, stream, pixel, sample), type_(type), sample_(sample),
+        sample_count_(sample_count == 0 ? 1 : sample_count),
+        key_(CounterRng::mix(
+            CounterRng::mix(seed ^ KEY_SALT ^ CounterRng::stream_salt(stream)) ^ pixel)) { }
+
+  void set_bounce(std::uint32_t bounce) {
+    rng_.set_bounce(bounce);
+    bounce_ = bounce;
+    dim_    = 0;
+  }
+
+  [[nodiscard]] double next_double() {
+    if (type_ == SamplerType::random or dim_ >= DIMS_PER_BOUNCE or bounce_ >= MAX_BOUNCES) {
+      return rng_.next_double();
+    }
+    std::uint32_t const d    = bounce_ * DIMS_PER_BOUNCE + dim_++;
+    std::uint64_t const pair = CounterRng::mix(key_ ^ (d / 2U));
+    bool const second        = (d % 2U) != 0U;
+    return type_ == SamplerType::sobol ? sobol(pair, second) : stratified(pair, second);
+  }
+
+  // Uniform in [lo, hi).
+  [[nodiscard]] double uniform(double lo, double hi) { return lo + (hi - lo) * next_double(); }
+
+private:
+  static constexpr std::uint64_t KEY_SALT = 0x632B'E59B'D9B4'E019ULL;
+
+  [[nodiscard]] static constexpr std::uint32_t reverse_bits(std::uint32_t x) {
+    x = ((x >> 1U) & 0x5555'5555U) | ((x & 0x5555'5555U) << 1U);
+    x = ((x >> 2U) & 0x3333'3333U) | ((x & 0x3333'3333U) << 2U);
+    x = ((x >> 4U) & 0x0F0F'0F0FU) | ((x & 0x0F0F'0F0FU) << 4U);
+    x = ((x >> 8U) & 0x00FF'00FFU) | ((x & 0x00FF'00FFU) << 8U);
+    return (x >> 16U) | (x << 16U);
+  }
+
+  // Laine-Karras style hash: each bit only depends on itself and lower bits, so applied
+  // to the reversed value it is a nested uniform (Owen) scramble.
+  [[nodiscard]] static constexpr std::uint32_t owen_scramble(std::uint32_t x,
+                                                            std::uint32_t seed) {
+    x  = reverse_bits(x);
+    x += seed;
+    x ^= x * 0x6C50'B47CU;
+    x ^= x * 0xB82F'1E52U;
+    x ^= x * 0xC7AF'E638U;
+    x ^= x * 0x8D22'F6E6U;
+    return reverse_bits(x);
+  }
+
+  // First two dimensions of Sobol': the van der Corput sequence and the one generated by
+  // x + 1, whose direction numbers are v_k = v_{k-1} ^ (v_{k-1} >> 1).
+  [[nodiscard]] static constexpr std::uint32_t sobol_second(std::uint32_t i) {
+    std::uint32_t v = 1U << 31U;
+    std::uint32_t r = 0;
+    for (; i != 0; i >>= 1U, v ^= v >> 1U) {
+      if ((i & 1U) != 0U) {
+        r ^= v;
+      }
+    }
+    return r;
+  }
+
+  [[nodiscard]] static double to_unit(std::uint32_t x) {
+    return static_cast<double>(x) * 0x1.0p-32;
+  }
+
+  [[nodiscard]] double sobol(std::uint64_t pair, bool second) const {
+    auto const h     = static_cast<std::uint32_t>(pair);
+    auto const index = owen_scramble(sample_, static_cast<std::uint32_t>(pair >> 32U));
+    std::uint32_t const x = second ? sobol_second(index) : reverse_bits(index);
+    return to_unit(owen_scramble(x, second ? h * 0x9E37'79B9U : h));
+  }
+
+  // Bijection of [0, n) keyed by seed: a bijective hash on the enclosing power of two,
+  // cycle-walked until it lands inside the range (after Kensler 2013).
+  [[nodiscard]] static std::uint32_t permute(std::uint32_t i, std::uint32_t n,
+                                             std::uint32_t seed) {
+    std::uint32_t w = n - 1;
+    w |= w >> 1U;
+    w |= w >> 2U;
+    w |= w >> 4U;
+    w |= w >> 8U;
+    w |= w >> 16U;
+    do {
+      i ^= seed;
+      i *= 0xE170'893DU;
+      i ^= seed >> 16U;
+      i ^= (i & w) >> 4U;
+      i ^= seed >> 8U;
+      i *= 0x0929'EB3FU;
+      i ^= seed >> 23U;
+      i ^= (i & w) >> 1U;
+      i *= 1U | seed >> 27U;
+      i *= 0x6935'FA69U;
+      i ^= (i & w) >> 11U;
+      i *= 0x74DC'B303U;
+      i ^= (i & w) >> 2U;
+      i &= w;
+      i ^= i >> 5U;
+    } while (i >= n);
+    return i;
+  }
+
+  // Jittered grid of nx * ny >= sample_count cells; every sample_count samples start a
+  // new round with a fresh order and fresh jitter.
+  [[nodiscard]] double stratified(std::uint64_t pair, bool second) const {
+    std::uint32_t const n     = sample_count_;
+    std::uint32_t const round = sample_ / n;
+    std::uint64_t const key   = CounterRng::mix(pair ^ round);
+    std::uint32_t const cell  = permute(sample_ % n, n, static_cast<std::uint32_t>(key));
+    auto const nx = static_cast<std::uint32_t>(std::ceil(std::sqrt(static_cast<double>(n))));
+    std::uint32_t const ny     = (n + nx - 1) / nx;
+    std::uint64_t const jitter = CounterRng::mix(key ^ (std::uint64_t{sample_} << 1U | second));
+    double const u             = static_cast<double>(jitter >> 11U) * 0x1.0p-53;
+    return second ? (static_cast<double>(cell / nx) + u) / static_cast<double>(ny)
+                  : (static_cast<double>(cell % nx) + u) / static_cast<double>(nx);
+  }
+
+  CounterRng rng_;
+  SamplerType type_;
+  std::uint32_t sample_;
+  std::uint32_t sample_count_;
+  std::uint64_t key_;
+  std::uint32_t bounce_ = 0;
+  std::uint32_t dim_    = 0;
+};
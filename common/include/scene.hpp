@@ -53,6 +53,6 @@ struct Scene {
   std::vector<Cylinder> cylinders;
 };
 
-// Step 3.A: only verifies the file exists and returns an empty Scene.
-// Parsing will be implemented in Step 3.B.
+// Parses a scene file: one material or object per line, "#" comments and blank lines
+// ignored. Prints the first error and exits on malformed input.
 Scene parse_scene(std::string_view scene_path);
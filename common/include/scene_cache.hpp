@@ -0,0 +1,52 @@
+#pragma once
+#include "render_scene.hpp"
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// ---------- Compiled scene cache ----------
+// A compiled scene is stored next to its text file as "<scene>.<hash>.scache", where
+// <hash> is the content hash of the text. The file is a header, a table of
+// (offset, count) per array in for_each_array order, then the arrays themselves at
+// 64-byte aligned offsets, exactly as they sit in memory. Loading maps the file and points
+// the RenderScene views into the mapping; nothing is decoded.
+
+// Hash of the scene text the cache is keyed by.
+std::uint64_t scene_text_hash(std::string_view text);
+
+// Cache file name for a scene file whose text hashes to text_hash.
+std::string scene_cache_path(std::string const & scene_path, std::uint64_t text_hash);
+
+// Maps a cache file. Returns false, leaving out untouched, if the file is missing,
+// was written by another version or layout, does not belong to this text, or holds an
+// index that points outside its target array.
+bool load_scene_cache(std::string const & cache_path, std::uint64_t text_hash,
+                      std::uint64_t text_size, RenderScene & out);
+
+// Writes the cache file through a temporary and a rename, so a concurrent reader never
+// maps a partial file. Throws std::runtime_error on failure.
+void write_scene_cache(std::string const & cache_path, std::uint64_t text_hash,
+                       std::uint64_t text_size, RenderScene const & rs);
+
+enum class SceneSource : std::uint8_t {
+  parsed,  // parsed and compiled; the cache was disabled or could not be written
+  cached,  // mapped from an existing cache file
+  stored,  // parsed and compiled, then written to a new cache file
+};
+
+// "parsed", "cache" or "parsed, cached", for the start-up report.
+std::string_view scene_source_name(SceneSource source);
+
+struct LoadedScene {
+  RenderScene scene;
+  SceneSource source = SceneSource::parsed;
+};
+
+// The render scene of a scene file: mapped from its cache when one matches the text,
+// otherwise parsed, compiled and, if use_cache, written to the cache for the next run.
+// Parse errors exit as parse_scene does; cache errors only print a warning.
+// Mapped pages come from the page cache, where the caller's NUMA policy does not reach:
+// with interleave, a scene loaded from the cache is copied into memory this thread
+// touches first (see ScopedNumaInterleave).
+LoadedScene load_render_scene(std::string const & scene_path, bool use_cache,
+                              bool interleave = false);
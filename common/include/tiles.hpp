@@ -0,0 +1,16 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Order in which the render loop hands out tiles. Space-filling curves keep tiles that
+// run at the same time close together, so they share scene data in cache.
+enum class TileOrder : std::uint8_t { scanline, morton, hilbert };
+
+// Block of the image, columns [x0, x1) and rows [y0, y1).
+struct Tile {
+  std::uint32_t x0, y0, x1, y1;
+};
+
+// Cuts a width x height image into tile_size squares (clipped at the right and bottom
+// edges) and lists them in the given order.
+std::vector<Tile> make_tiles(int width, int height, int tile_size, TileOrder order);
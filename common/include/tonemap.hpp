@@ -0,0 +1,56 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Linear colour to an 8-bit gamma-encoded value: floor(255 * clamp(v, 0, 1)^(1/gamma)),
+// or the linear value for gamma <= 0. Instead of pow, a table over the float exponent and
+// the top mantissa bits gives the byte at the start of each bin, and one comparison with
+// the next quantisation threshold corrects it. Bins are made fine enough that none holds
+// two thresholds. The thresholds are themselves rounded, so doubles and floats are at
+// most one step off the pow result, exact away from quantisation thresholds. A gamma the
+// table cannot represent (beyond about 15, where the first threshold is no longer a normal
+// float, or so close to 0 that 2^16 bins per octave cannot separate the thresholds) falls
+// back to pow.
+class ToneMapper {
+public:
+  // Selects the widest plane kernel the CPU supports in apply().
+  static constexpr std::uint32_t WIDEST_KERNEL = ~std::uint32_t{0};
+
+  explicit ToneMapper(double gamma);
+
+  [[nodiscard]] std::uint8_t operator()(double v) const;
+
+  // out[i] = map(in[i] * scale) for i in [0, n), vectorised where the CPU allows.
+  void apply(float const * in, float scale, std::size_t n, std::uint8_t * out,
+             std::uint32_t kernel = WIDEST_KERNEL) const;
+
+  // out[i] = map(sums[i] / counts[i]) for i in [0, n); counts must be non-zero.
+  void apply(float const * sums, std::uint32_t const * counts, std::size_t n,
+             std::uint8_t * out, std::uint32_t kernel = WIDEST_KERNEL) const;
+
+  // Whether this gamma is mapped with pow rather than the table.
+  [[nodiscard]] bool exact() const { return exact_; }
+
+private:
+  [[nodiscard]] std::uint8_t map_pow(double v) const;
+
+  void apply_table(float const * in, std::uint32_t const * counts, float scale, std::size_t n,
+                   std::uint8_t * out, std::uint32_t kernel) const;
+
+  std::vector<std::uint8_t> bins_;         // byte at the start of each bin, plus gather padding
+  std::array<double, 257> thresholds_{};   // [k]: smallest input that maps to k; [256] = inf
+  std::array<float, 257> thresholds_f_{};  // the same, rounded to float
+  double gamma_                = 0.0;
+  bool exact_                  = false;    // the table cannot hold this gamma: use pow
+  std::uint32_t mantissa_bits_ = 0;        // bins per octave = 2^mantissa_bits_
+  std::int64_t first_bin_      = 0;        // top bits of the first bin's lower edge (double)
+  std::int32_t first_bin_f_    = 0;        // the same for the float layout
+  std::int32_t last_bin_       = 0;
+};
+
+// Plane kernels the running CPU supports, scalar at index 0 and the widest last, so that
+// tests can pass each index to ToneMapper::apply.
+std::uint32_t num_tonemap_kernels();
+char const * tonemap_kernel_name(std::uint32_t index);
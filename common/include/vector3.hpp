@@ -0,0 +1,40 @@
+#pragma once
+#include <array>
+#include <cmath>
+
+// Vector arithmetic shared by the intersection code and the scene compiler, so the
+// cylinder axis, caps and squared radii precomputed at compile time are bit-identical to
+// what the intersection code would derive from the same inputs.
+
+inline constexpr double NORMALIZE_EPSILON = 1e-12;
+
+[[nodiscard]] inline double dot(std::array<double, 3> const & a, std::array<double, 3> const & b) {
+  return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+[[nodiscard]] inline std::array<double, 3> sub(std::array<double, 3> const & a,
+                                               std::array<double, 3> const & b) {
+  return {a[0] - b[0], a[1] - b[1], a[2] - b[2]};
+}
+
+[[nodiscard]] inline std::array<double, 3> add(std::array<double, 3> const & a,
+                                               std::array<double, 3> const & b) {
+  return {a[0] + b[0], a[1] + b[1], a[2] + b[2]};
+}
+
+[[nodiscard]] inline std::array<double, 3> mul(std::array<double, 3> const & a, double s) {
+  return {a[0] * s, a[1] * s, a[2] * s};
+}
+
+[[nodiscard]] inline double length(std::array<double, 3> const & a) {
+  return std::sqrt(a[0] * a[0] + a[1] * a[1] + a[2] * a[2]);
+}
+
+// Vectors shorter than NORMALIZE_EPSILON come out as zero.
+[[nodiscard]] inline std::array<double, 3> normalize(std::array<double, 3> const & a) {
+  double const n = length(a);
+  if (n > NORMALIZE_EPSILON) {
+    return {a[0] / n, a[1] / n, a[2] / n};
+  }
+  return {0.0, 0.0, 0.0};
+}
@@ -0,0 +1,230 @@
+#include "../include/bvh.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace {
+
+  constexpr std::size_t NUM_BINS      = 16;
+  constexpr std::size_t MAX_LEAF_SIZE = 8;  // one AVX-512 block of doubles
+  constexpr double COST_TRAVERSAL     = 1.0;
+  constexpr double COST_INTERSECT     = 1.0;
+
+  constexpr double INF = std::numeric_limits<double>::infinity();
+
+  // Local helpers over the public Aabb.
+  struct Box : Aabb {
+    void grow(std::array<double, 3> const & p) {
+      for (std::size_t i = 0; i < 3; ++i) {
+        lo.at(i) = std::min(lo.at(i), p.at(i));
+        hi.at(i) = std::max(hi.at(i), p.at(i));
+      }
+    }
+
+    void grow(Aabb const & b) {
+      grow(b.lo);
+      grow(b.hi);
+    }
+
+    [[nodiscard]] double area() const {
+      double const dx = hi[0] - lo[0];
+      double const dy = hi[1] - lo[1];
+      double const dz = hi[2] - lo[2];
+      if (dx < 0.0 or dy < 0.0 or dz < 0.0) {
+        return 0.0;
+      }
+      return 2.0 * (dx * dy + dy * dz + dz * dx);
+    }
+  };
+
+  struct PrimInfo {
+    Aabb box;
+    std::array<double, 3> centroid{};
+    std::uint32_t id{};
+  };
+
+  [[nodiscard]] std::array<double, 3> centre_of(Aabb const & b) {
+    return {(b.lo[0] + b.hi[0]) * 0.5, (b.lo[1] + b.hi[1]) * 0.5, (b.lo[2] + b.hi[2]) * 0.5};
+  }
+
+  struct Bin {
+    Box box;
+    std::size_t count = 0;
+  };
+
+  struct Split {
+    std::size_t axis = 0;
+    std::size_t bin  = 0;  // primitives in bins [0, bin] go left
+    double cost      = INF;
+  };
+
+  class Builder {
+  public:
+    Builder(std::vector<PrimInfo> & prims, Bvh & out) : prims_(prims), out_(out) { }
+
+    std::uint32_t build(std::size_t begin, std::size_t end, std::size_t depth) {
+      auto const node_index = static_cast<std::uint32_t>(out_.nodes.size());
+      out_.nodes.emplace_back();
+
+      Box bounds;
+      Box centroids;
+      for (std::size_t i = begin; i < end; ++i) {
+        bounds.grow(prims_[i].box);
+        centroids.grow(prims_[i].centroid);
+      }
+      std::size_t const count = end - begin;
+
+      std::size_t mid = end;
+      Split const best = find_split(begin, end, centroids, bounds);
+      bool const sah_prefers_leaf =
+          best.cost >= COST_INTERSECT * static_cast<double>(count) and count <= MAX_LEAF_SIZE;
+      if (count <= 1 or depth >= BVH_MAX_DEPTH or sah_prefers_leaf) {
+        make_leaf(node_index, bounds, begin, count);
+        return node_index;
+      }
+
+      if (best.cost < INF) {
+        mid = partition(begin, end, centroids, best);
+      }
+      if (mid == begin or mid == end) {
+        // All centroids fall in one bin (e.g. coincident objects): split by count.
+        mid = begin + count / 2;
+      }
+
+      build(begin, mid, depth + 1);
+      std::uint32_t const second = build(mid, end, depth + 1);
+
+      BvhNode & node = out_.nodes[node_index];
+      node.lo        = bounds.lo;
+      node.hi        = bounds.hi;
+      node.offset    = second;
+      node.axis      = static_cast<std::uint16_t>(best.axis);
+      return node_index;
+    }
+
+  private:
+    [[nodiscard]] std::size_t bin_of(PrimInfo const & p, Box const & centroids,
+                                     std::size_t axis) const {
+      double const lo     = centroids.lo.at(axis);
+      double const extent = centroids.hi.at(axis) - lo;
+      auto const bin      = static_cast<std::size_t>((p.centroid.at(axis) - lo) / extent *
+                                                static_cast<double>(NUM_BINS));
+      return std::min(bin, NUM_BINS - 1);
+    }
+
+    [[nodiscard]] Split find_split(std::size_t begin, std::size_t end, Box const & centroids,
+                                   Box const & bounds) const {
+      Split best;
+      double const parent_area = bounds.area();
+      if (parent_area <= 0.0) {
+        return best;
+      }
+      for (std::size_t axis = 0; axis < 3; ++axis) {
+        if (centroids.hi.at(axis) - centroids.lo.at(axis) <= 0.0) {
+          continue;
+        }
+        std::array<Bin, NUM_BINS> bins{};
+        for (std::size_t i = begin; i < end; ++i) {
+          auto & bin = bins.at(bin_of(prims_[i], centroids, axis));
+          bin.box.grow(prims_[i].box);
+          ++bin.count;
+        }
+
+        // Sweep from the right to get the cost of every "right" half, then from the left.
+        std::array<double, NUM_BINS> right_area{};
+        std::array<std::size_t, NUM_BINS> right_count{};
+        Box acc;
+        std::size_t n = 0;
+        for (std::size_t b = NUM_BINS - 1; b > 0; --b) {
+          acc.grow(bins.at(b).box);
+          n                     += bins.at(b).count;
+          right_area.at(b - 1)   = acc.area();
+          right_count.at(b - 1)  = n;
+        }
+
+        acc = Box{};
+        n   = 0;
+        for (std::size_t b = 0; b + 1 < NUM_BINS; ++b) {
+          acc.grow(bins.at(b).box);
+          n += bins.at(b).count;
+          if (n == 0 or right_count.at(b) == 0) {
+            continue;
+          }
+          double const cost = COST_TRAVERSAL + COST_INTERSECT *
+                                                   (acc.area() * static_cast<double>(n) +
+                                                    right_area.at(b) *
+                                                        static_cast<double>(right_count.at(b))) /
+                                                   parent_area;
+          if (cost < best.cost) {
+            best = Split{axis, b, cost};
+          }
+        }
+      }
+      return best;
+    }
+
+    std::size_t partition(std::size_t begin, std::size_t end, Box const & centroids,
+                          Split const & split) {
+      auto const first = prims_.begin() + static_cast<std::ptrdiff_t>(begin);
+      auto const last  = prims_.begin() + static_cast<std::ptrdiff_t>(end);
+      auto const it    = std::partition(first, last, [&](PrimInfo const & p) {
+        return bin_of(p, centroids, split.axis) <= split.bin;
+      });
+      return static_cast<std::size_t>(it - prims_.begin());
+    }
+
+    // Spheres have the lowest ids, so sorting the leaf by id puts them first and keeps
+    // each run in brute-force order.
+    void make_leaf(std::uint32_t node_index, Box const & bounds, std::size_t begin,
+                   std::size_t count) {
+      auto const first = prims_.begin() + static_cast<std::ptrdiff_t>(begin);
+      std::sort(first, first + static_cast<std::ptrdiff_t>(count),
+                [](PrimInfo const & a, PrimInfo const & b) { return a.id < b.id; });
+
+      BvhNode & node  = out_.nodes[node_index];
+      node.lo         = bounds.lo;
+      node.hi         = bounds.hi;
+      node.offset     = static_cast<std::uint32_t>(out_.sphere_ids.size());
+      node.cyl_offset = static_cast<std::uint32_t>(out_.cylinder_ids.size());
+      for (std::size_t i = begin; i < begin + count; ++i) {
+        std::uint32_t const id = prims_[i].id;
+        if (id < out_.num_spheres) {
+          out_.sphere_ids.push_back(id);
+          ++node.count;
+        } else {
+          out_.cylinder_ids.push_back(id - out_.num_spheres);
+          ++node.cyl_count;
+        }
+      }
+    }
+
+    std::vector<PrimInfo> & prims_;
+    Bvh & out_;
+  };
+
+}  // namespace
+
+Bvh build_bvh(std::vector<Aabb> const & bounds, std::uint32_t num_spheres) {
+  Bvh bvh;
+  bvh.num_spheres = num_spheres;
+  if (bounds.empty()) {
+    return bvh;
+  }
+
+  std::vector<PrimInfo> prims;
+  prims.reserve(bounds.size());
+  for (auto const & box : bounds) {
+    prims.push_back({box, centre_of(box), static_cast<std::uint32_t>(prims.size())});
+  }
+
+  bvh.nodes.reserve(2 * prims.size());
+  bvh.sphere_ids.reserve(num_spheres);
+  bvh.cylinder_ids.reserve(prims.size() - num_spheres);
+  Builder builder(prims, bvh);
+  builder.build(0, prims.size(), 0);
+  return bvh;
+}
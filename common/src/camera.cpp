@@ -134,6 +134,27 @@ Camera make_camera_from_config(Config const & cfg) {
   cam.gamma             = cfg.gamma;
   cam.samples_per_pixel = cfg.samples_per_pixel;
   cam.max_depth         = cfg.max_depth;
+  // Path termination: early exit on low throughput and optional Russian roulette.
+  cam.throughput_threshold   = cfg.throughput_threshold;
+  cam.russian_roulette_depth = cfg.russian_roulette_depth;
+  // Adaptive sampling: samples_per_pixel is the mean budget, so the cap cannot be below it.
+  if (cfg.adaptive_max_samples > 0 and cfg.adaptive_max_samples < cfg.samples_per_pixel) {
+    std::cerr << "Error: adaptive_max_samples must be at least samples_per_pixel.\n";
+    std::exit(EXIT_FAILURE);
+  }
+  cam.adaptive_max_samples = cfg.adaptive_max_samples;
+  cam.adaptive_min_samples = cfg.adaptive_min_samples;
+  cam.adaptive_error       = cfg.adaptive_error;
+  // Progressive passes always sample the whole frame uniformly.
+  if (cfg.progressive_samples > 0 and cfg.adaptive_max_samples > 0) {
+    std::cerr << "Error: progressive_samples cannot be combined with adaptive sampling.\n";
+    std::exit(EXIT_FAILURE);
+  }
+  cam.progressive_samples  = cfg.progressive_samples;
+  cam.progressive_interval = cfg.progressive_interval;
+  cam.tile_size  = cfg.tile_size;
+  cam.tile_order = cfg.tile_order;
+  cam.sampler    = cfg.sampler;
   cam.material_rng_seed =
       static_cast<std::uint64_t>(static_cast<std::uint32_t>(cfg.material_rng_seed));
   cam.ray_rng_seed = static_cast<std::uint64_t>(static_cast<std::uint32_t>(cfg.ray_rng_seed));
@@ -1,19 +1,145 @@
 #include "../include/cli.hpp"
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
 #include <cstdlib>
 #include <iostream>
 #include <string_view>
+#include <system_error>
 #include <vector>
 
-CLIArgs parse_cli(std::vector<std::string_view> const & args, std::string_view exec_name) {
-  // args[0] is the executable name; we expect 4 tokens total
-  if (args.size() != 4) {
-    std::cerr << "Usage: " << exec_name << " <config.txt> <scene.txt> <output.ppm>\n";
+namespace {
+
+  [[noreturn]] void fail_usage(std::string_view exec_name, CliLayout layout) {
+    std::cerr << "Usage: " << exec_name;
+    if (layout == CliLayout::aos) {
+      std::cerr << " [--tile-size <pixels>] [--threads <n>] [--pin] [--numa] [--format p3|p6]"
+                   " [--no-scene-cache] <config.txt> <scene.txt> <output.ppm>\n";
+    } else {
+      std::cerr << " [--time-budget <seconds>] [--tile-size <pixels>] [--tile-costs <file.csv>]"
+                   " [--threads <n>] [--pin] [--numa] [--huge-pages] [--format p3|p6|pfm]"
+                   " [--pfm <file.pfm>] [--mmap] [--stream <bands>] [--no-scene-cache]"
+                   " <config.txt> <scene.txt> <output.ppm>\n";
+    }
+    std::exit(EXIT_FAILURE);
+  }
+
+  // Options that need the SOA float planes, per-tile times or huge-page planes, or that
+  // write the image while rendering.
+  constexpr std::array<std::string_view, 6> SOA_ONLY_OPTIONS{
+    "--time-budget", "--tile-costs", "--huge-pages", "--pfm", "--mmap", "--stream"};
+
+  [[noreturn]] void fail_option(std::string_view option, std::string_view text) {
+    std::cerr << "Error: Invalid " << option << " value: " << text << "\n";
     std::exit(EXIT_FAILURE);
   }
 
+  // Value following the option at args[i]; advances i past it.
+  std::string_view option_value(std::vector<std::string_view> const & args, std::size_t & i,
+                                std::string_view exec_name, CliLayout layout) {
+    if (i + 1 == args.size()) {
+      fail_usage(exec_name, layout);
+    }
+    return args[++i];
+  }
+
+  // About eleven days. steady_clock counts nanoseconds in 64 bits, so far larger budgets
+  // would overflow when main turns them into a deadline.
+  constexpr double MAX_TIME_BUDGET = 1e6;
+
+  double parse_time_budget(std::string_view text) {
+    double seconds{};
+    auto const [end, ec] = std::from_chars(text.data(), text.data() + text.size(), seconds);
+    if (ec != std::errc{} or end != text.data() + text.size() or not std::isfinite(seconds) or
+        seconds <= 0.0 or seconds > MAX_TIME_BUDGET) {
+      fail_option("--time-budget", text);
+    }
+    return seconds;
+  }
+
+  int parse_positive_int(std::string_view option, std::string_view text) {
+    int value{};
+    auto const [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (ec != std::errc{} or end != text.data() + text.size() or value <= 0) {
+      fail_option(option, text);
+    }
+    return value;
+  }
+
+}  // namespace
+
+CLIArgs parse_cli(std::vector<std::string_view> const & args, std::string_view exec_name,
+                  CliLayout layout) {
+  // args[0] is the executable name; options may appear anywhere before or between the
+  // three positional paths.
   CLIArgs out;
-  out.config_path = std::string(args[1]);
-  out.scene_path  = std::string(args[2]);
-  out.output_path = std::string(args[3]);
+  std::vector<std::string_view> positional;
+  for (std::size_t i = 1; i < args.size(); ++i) {
+    if (layout == CliLayout::aos and
+        std::ranges::find(SOA_ONLY_OPTIONS, args[i]) != SOA_ONLY_OPTIONS.end()) {
+      fail_usage(exec_name, layout);
+    }
+    if (args[i] == "--time-budget") {
+      out.time_budget = parse_time_budget(option_value(args, i, exec_name, layout));
+    } else if (args[i] == "--tile-size") {
+      out.tile_size = parse_positive_int("--tile-size", option_value(args, i, exec_name, layout));
+    } else if (args[i] == "--tile-costs") {
+      out.tile_costs_path = std::string(option_value(args, i, exec_name, layout));
+    } else if (args[i] == "--threads") {
+      out.threads = parse_positive_int("--threads", option_value(args, i, exec_name, layout));
+    } else if (args[i] == "--pin") {
+      out.pin = true;
+    } else if (args[i] == "--numa") {
+      out.numa = true;
+    } else if (args[i] == "--huge-pages") {
+      out.huge_pages = true;
+    } else if (args[i] == "--format") {
+      out.format = std::string(option_value(args, i, exec_name, layout));
+      if (out.format != "p3" and out.format != "p6" and
+          (out.format != "pfm" or layout == CliLayout::aos)) {
+        fail_option("--format", out.format);
+      }
+    } else if (args[i] == "--pfm") {
+      out.pfm_path = std::string(option_value(args, i, exec_name, layout));
+    } else if (args[i] == "--mmap") {
+      out.mmap = true;
+    } else if (args[i] == "--stream") {
+      out.stream_bands = parse_positive_int("--stream", option_value(args, i, exec_name, layout));
+    } else if (args[i] == "--no-scene-cache") {
+      out.scene_cache = false;
+    } else {
+      positional.push_back(args[i]);
+    }
+  }
+  if (positional.size() != 3) {
+    fail_usage(exec_name, layout);
+  }
+  out.config_path = std::string(positional[0]);
+  out.scene_path  = std::string(positional[1]);
+  out.output_path = std::string(positional[2]);
+
+  bool const pfm = out.format == "pfm" or out.output_path.ends_with(".pfm") or
+                   not out.pfm_path.empty();
+  if (out.mmap) {
+    // The mapped file has a fixed size, so it can only hold a binary image; a .ppm name
+    // means P3 unless --format p6 says otherwise, and a .pfm name is never P6.
+    bool const p6 =
+        out.format == "p6" or (out.format.empty() and out.output_path.ends_with(".pnm"));
+    if (not p6 or out.output_path.ends_with(".pfm") or out.time_budget > 0.0 or
+        not out.pfm_path.empty()) {
+      std::cerr << "Error: --mmap writes a P6 image of a fixed-spp render: it needs a .pnm "
+                   "output or --format p6, and cannot be combined with --format p3|pfm, a .pfm "
+                   "output, --pfm or --time-budget\n";
+      std::exit(EXIT_FAILURE);
+    }
+    out.format = "p6";
+  }
+  if (out.stream_bands > 0 and (out.mmap or out.time_budget > 0.0 or pfm)) {
+    // PFM stores rows bottom to top, so it cannot be written in render order.
+    std::cerr << "Error: --stream cannot be combined with --mmap, --time-budget or PFM output\n";
+    std::exit(EXIT_FAILURE);
+  }
+
   return out;
 }
@@ -212,6 +212,110 @@ namespace {
     cfg.max_depth = n;
   }
 
+  inline void handle_throughput_threshold(std::istringstream & iss, Config & cfg,
+                                          std::string const & key) {
+    double t{};
+    if (!read_double(iss, t) or t < 0.0 or t >= 1.0) {
+      fail_invalid_value(key);
+    }
+    ensure_no_tail(iss, key);
+    cfg.throughput_threshold = t;
+  }
+
+  inline void handle_russian_roulette_depth(std::istringstream & iss, Config & cfg,
+                                            std::string const & key) {
+    int n{};
+    if (!read_int(iss, n) or n < 0) {
+      fail_invalid_value(key);
+    }
+    ensure_no_tail(iss, key);
+    cfg.russian_roulette_depth = n;
+  }
+
+  inline void handle_adaptive_samples(std::istringstream & iss, int & dst, int min_value,
+                                      std::string const & key) {
+    int n{};
+    if (!read_int(iss, n) or n < min_value) {
+      fail_invalid_value(key);
+    }
+    ensure_no_tail(iss, key);
+    dst = n;
+  }
+
+  inline void handle_adaptive_error(std::istringstream & iss, Config & cfg,
+                                    std::string const & key) {
+    double e{};
+    if (!read_double(iss, e) or e <= 0.0) {
+      fail_invalid_value(key);
+    }
+    ensure_no_tail(iss, key);
+    cfg.adaptive_error = e;
+  }
+
+  inline void handle_progressive_samples(std::istringstream & iss, Config & cfg,
+                                         std::string const & key) {
+    int n{};
+    if (!read_int(iss, n) or n < 0) {
+      fail_invalid_value(key);
+    }
+    ensure_no_tail(iss, key);
+    cfg.progressive_samples = n;
+  }
+
+  inline void handle_progressive_interval(std::istringstream & iss, Config & cfg,
+                                          std::string const & key) {
+    double t{};
+    if (!read_double(iss, t) or t < 0.0) {
+      fail_invalid_value(key);
+    }
+    ensure_no_tail(iss, key);
+    cfg.progressive_interval = t;
+  }
+
+  inline void handle_tile_size(std::istringstream & iss, Config & cfg, std::string const & key) {
+    int n{};
+    if (!read_int(iss, n) or n <= 0) {
+      fail_invalid_value(key);
+    }
+    ensure_no_tail(iss, key);
+    cfg.tile_size = n;
+  }
+
+  inline void handle_tile_order(std::istringstream & iss, Config & cfg,
+                                std::string const & key) {
+    std::string name;
+    if (!(iss >> name)) {
+      fail_invalid_value(key);
+    }
+    if (name == "scanline") {
+      cfg.tile_order = TileOrder::scanline;
+    } else if (name == "morton") {
+      cfg.tile_order = TileOrder::morton;
+    } else if (name == "hilbert") {
+      cfg.tile_order = TileOrder::hilbert;
+    } else {
+      fail_invalid_value(key);
+    }
+    ensure_no_tail(iss, key);
+  }
+
+  inline void handle_sampler(std::istringstream & iss, Config & cfg, std::string const & key) {
+    std::string name;
+    if (!(iss >> name)) {
+      fail_invalid_value(key);
+    }
+    if (name == "random") {
+      cfg.sampler = SamplerType::random;
+    } else if (name == "stratified") {
+      cfg.sampler = SamplerType::stratified;
+    } else if (name == "sobol") {
+      cfg.sampler = SamplerType::sobol;
+    } else {
+      fail_invalid_value(key);
+    }
+    ensure_no_tail(iss, key);
+  }
+
   inline void handle_seed(std::istringstream & iss, int & dst, std::string const & key) {
     int n{};
     if (!read_int(iss, n)) {
@@ -296,12 +400,58 @@ namespace {
 
     handlers.emplace("max_depth", [](std::istringstream & iss, Config & cfg,
                                      std::string const & key) { handle_max_depth(iss, cfg, key); });
+
+    handlers.emplace("throughput_threshold",
+                     [](std::istringstream & iss, Config & cfg, std::string const & key) {
+                       handle_throughput_threshold(iss, cfg, key);
+                     });
+
+    handlers.emplace("russian_roulette_depth",
+                     [](std::istringstream & iss, Config & cfg, std::string const & key) {
+                       handle_russian_roulette_depth(iss, cfg, key);
+                     });
+
+    handlers.emplace("adaptive_max_samples",
+                     [](std::istringstream & iss, Config & cfg, std::string const & key) {
+                       handle_adaptive_samples(iss, cfg.adaptive_max_samples, 0, key);
+                     });
+
+    handlers.emplace("adaptive_min_samples",
+                     [](std::istringstream & iss, Config & cfg, std::string const & key) {
+                       handle_adaptive_samples(iss, cfg.adaptive_min_samples, 2, key);
+                     });
+
+    handlers.emplace("adaptive_error",
+                     [](std::istringstream & iss, Config & cfg, std::string const & key) {
+                       handle_adaptive_error(iss, cfg, key);
+                     });
+
+    handlers.emplace("progressive_samples",
+                     [](std::istringstream & iss, Config & cfg, std::string const & key) {
+                       handle_progressive_samples(iss, cfg, key);
+                     });
+
+    handlers.emplace("progressive_interval",
+                     [](std::istringstream & iss, Config & cfg, std::string const & key) {
+                       handle_progressive_interval(iss, cfg, key);
+                     });
+
+    handlers.emplace("tile_size", [](std::istringstream & iss, Config & cfg,
+                                     std::string const & key) { handle_tile_size(iss, cfg, key); });
+
+    handlers.emplace("tile_order",
+                     [](std::istringstream & iss, Config & cfg, std::string const & key) {
+                       handle_tile_order(iss, cfg, key);
+                     });
   }
 
   inline void add_seed_and_bg_handlers(
       std::unordered_map<std::string,
                          std::function<void(std::istringstream &, Config &, std::string const &)>> &
           handlers) {
+    handlers.emplace("sampler", [](std::istringstream & iss, Config & cfg,
+                                   std::string const & key) { handle_sampler(iss, cfg, key); });
+
     handlers.emplace("material_rng_seed",
                      [](std::istringstream & iss, Config & cfg, std::string const & key) {
                        handle_seed(iss, cfg.material_rng_seed, key);
@@ -0,0 +1,131 @@
+#include "../include/execution.hpp"
+#include <cstddef>
+#include <functional>
+#include <oneapi/tbb/task_arena.h>
+#include <oneapi/tbb/task_scheduler_observer.h>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+#include <filesystem>
+#include <sched.h>
+#include <string>
+#include <system_error>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+#ifdef __linux__
+
+  // CPUs this process may run on (respects taskset, cgroups and the like).
+  std::vector<std::size_t> allowed_cpus() {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    std::vector<std::size_t> cpus;
+    if (sched_getaffinity(0, sizeof(set), &set) != 0) {
+      return cpus;
+    }
+    for (std::size_t cpu = 0; cpu < std::size_t{CPU_SETSIZE}; ++cpu) {
+      if (CPU_ISSET(cpu, &set)) {
+        cpus.push_back(cpu);
+      }
+    }
+    return cpus;
+  }
+
+  // Pins the thread in arena slot i to the i-th allowed CPU, wrapping around.
+  class PinningObserver final : public tbb::task_scheduler_observer {
+  public:
+    PinningObserver(tbb::task_arena & arena, std::vector<std::size_t> cpus)
+        : tbb::task_scheduler_observer(arena), cpus_(std::move(cpus)) {
+      observe(true);
+    }
+
+    ~PinningObserver() override { observe(false); }
+
+    PinningObserver(PinningObserver const &)             = delete;
+    PinningObserver & operator=(PinningObserver const &) = delete;
+
+    void on_scheduler_entry(bool /*is_worker*/) override {
+      int const slot = tbb::this_task_arena::current_thread_index();
+      if (cpus_.empty() or slot < 0) {
+        return;
+      }
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      CPU_SET(cpus_[static_cast<std::size_t>(slot) % cpus_.size()], &set);
+      (void) sched_setaffinity(0, sizeof(set), &set);
+    }
+
+  private:
+    std::vector<std::size_t> cpus_;
+  };
+
+  // Memory policy modes from <linux/mempolicy.h>; set through the raw syscall so there
+  // is no libnuma dependency.
+  constexpr int MEMPOLICY_DEFAULT    = 0;
+  constexpr int MEMPOLICY_INTERLEAVE = 3;
+
+  // Bit mask of the NUMA nodes the kernel exposes (first 64 only).
+  unsigned long numa_node_mask() {
+    unsigned long mask = 0;
+    std::error_code ec;
+    std::filesystem::directory_iterator const nodes("/sys/devices/system/node", ec);
+    for (auto const & entry : nodes) {
+      std::string const name = entry.path().filename().string();
+      if (name.size() > 4 and name.starts_with("node") and
+          name.find_first_not_of("0123456789", 4) == std::string::npos) {
+        auto const node = std::stoul(name.substr(4));
+        if (node < 64) {
+          mask |= 1UL << node;
+        }
+      }
+    }
+    return mask;
+  }
+
+  bool set_memory_policy(int mode, unsigned long const * mask, unsigned long max_node) {
+    return syscall(SYS_set_mempolicy, mode, mask, max_node) == 0;
+  }
+
+#endif
+
+}  // namespace
+
+void run_in_arena(ExecutionOptions const & opts, std::function<void()> const & fn) {
+  tbb::task_arena arena(opts.threads > 0 ? opts.threads : tbb::task_arena::automatic);
+  arena.initialize();
+#ifdef __linux__
+  std::optional<PinningObserver> pinning;
+  if (opts.pin) {
+    pinning.emplace(arena, allowed_cpus());
+  }
+#endif
+  arena.execute(fn);
+}
+
+ScopedNumaInterleave::ScopedNumaInterleave([[maybe_unused]] bool enabled) {
+#ifdef __linux__
+  if (not enabled) {
+    return;
+  }
+  unsigned long const mask = numa_node_mask();
+  // One node (or none visible): nothing to interleave across.
+  if ((mask & (mask - 1)) == 0) {
+    return;
+  }
+  // The kernel reads max_node - 1 bits.
+  active_ = set_memory_policy(MEMPOLICY_INTERLEAVE, &mask, 8 * sizeof(mask) + 1);
+#endif
+}
+
+ScopedNumaInterleave::~ScopedNumaInterleave() {
+#ifdef __linux__
+  if (active_) {
+    (void) set_memory_policy(MEMPOLICY_DEFAULT, nullptr, 0);
+  }
+#endif
+}
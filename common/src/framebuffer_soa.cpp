@@ -0,0 +1,46 @@
+#include "../include/framebuffer_soa.hpp"
+#include <atomic>
+#include <cstddef>
+#include <new>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace {
+
+  std::atomic<bool> paginas_enormes{false};
+
+  // la alineacion depende solo del tamanyo, asi reservar y liberar coinciden aunque
+  // setHugePagesSOA cambie entre medias
+  [[nodiscard]] std::size_t alineacion_de(std::size_t bytes) noexcept {
+    return bytes >= TAM_PAGINA_ENORME ? TAM_PAGINA_ENORME : ALINEACION_PLANO;
+  }
+
+  [[nodiscard]] std::size_t redondear(std::size_t bytes, std::size_t alineacion) noexcept {
+    return (bytes + alineacion - 1) / alineacion * alineacion;
+  }
+
+}  // namespace
+
+void setHugePagesSOA(bool activar) {
+  paginas_enormes.store(activar, std::memory_order_relaxed);
+}
+
+void * reservarPlanoSOA(std::size_t bytes) {
+  std::size_t const alineacion = alineacion_de(bytes);
+  std::size_t const total      = redondear(bytes, alineacion);
+  void * const datos           = ::operator new(total, std::align_val_t{alineacion});
+#ifdef __linux__
+  if (alineacion == TAM_PAGINA_ENORME and paginas_enormes.load(std::memory_order_relaxed)) {
+    // solo una sugerencia: si el sistema no tiene paginas enormes siguen las normales
+    (void) ::madvise(datos, total, MADV_HUGEPAGE);
+  }
+#endif
+  return datos;
+}
+
+void liberarPlanoSOA(void * datos, std::size_t bytes) noexcept {
+  std::size_t const alineacion = alineacion_de(bytes);
+  ::operator delete(datos, redondear(bytes, alineacion), std::align_val_t{alineacion});
+}
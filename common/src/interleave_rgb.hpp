@@ -0,0 +1,18 @@
+#pragma once
+// Plane-to-triplet interleave used by the binary image writers. One translation unit per
+// instruction set, picked at run time like the intersection kernels.
+#include <cstddef>
+#include <cstdint>
+
+namespace kernels {
+
+  // out[3i], out[3i+1], out[3i+2] = r[i], g[i], b[i] for i in [0, n).
+  using InterleaveRgbFn = void (*)(std::uint8_t const * r, std::uint8_t const * g,
+                                   std::uint8_t const * b, std::size_t n, std::uint8_t * out);
+
+#if defined(RENDER_X86_KERNELS)
+  void interleave_rgb_ssse3(std::uint8_t const * r, std::uint8_t const * g,
+                            std::uint8_t const * b, std::size_t n, std::uint8_t * out);
+#endif
+
+}  // namespace kernels
@@ -0,0 +1,56 @@
+// Compiled with -mssse3: sixteen pixels per step with pshufb.
+#include "interleave_rgb.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <immintrin.h>
+
+namespace {
+
+  // One output vector: the bytes each plane contributes, merged.
+  inline __m128i gather3(__m128i vr, __m128i vg, __m128i vb, __m128i mr, __m128i mg,
+                         __m128i mb) {
+    return _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(vr, mr), _mm_shuffle_epi8(vg, mg)),
+                        _mm_shuffle_epi8(vb, mb));
+  }
+
+}  // namespace
+
+namespace kernels {
+  // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+  // Sixteen pixels make three output vectors. Each output vector takes bytes from each
+  // of the three planes; -1 lanes are zeroed by pshufb so the three shuffles can be OR-ed.
+  void interleave_rgb_ssse3(std::uint8_t const * r, std::uint8_t const * g,
+                            std::uint8_t const * b, std::size_t n, std::uint8_t * out) {
+    __m128i const r0 = _mm_setr_epi8(0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1, 5);
+    __m128i const g0 = _mm_setr_epi8(-1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1);
+    __m128i const b0 = _mm_setr_epi8(-1, -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1);
+    __m128i const r1 = _mm_setr_epi8(-1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10, -1);
+    __m128i const g1 = _mm_setr_epi8(5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10);
+    __m128i const b1 = _mm_setr_epi8(-1, 5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1);
+    __m128i const r2 = _mm_setr_epi8(-1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1,
+                                     -1);
+    __m128i const g2 = _mm_setr_epi8(-1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15,
+                                     -1);
+    __m128i const b2 = _mm_setr_epi8(10, -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1,
+                                     15);
+
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+      __m128i const vr = _mm_loadu_si128(reinterpret_cast<__m128i const *>(r + i));
+      __m128i const vg = _mm_loadu_si128(reinterpret_cast<__m128i const *>(g + i));
+      __m128i const vb = _mm_loadu_si128(reinterpret_cast<__m128i const *>(b + i));
+      auto * dst       = reinterpret_cast<__m128i *>(out + 3 * i);
+      _mm_storeu_si128(dst, gather3(vr, vg, vb, r0, g0, b0));
+      _mm_storeu_si128(dst + 1, gather3(vr, vg, vb, r1, g1, b1));
+      _mm_storeu_si128(dst + 2, gather3(vr, vg, vb, r2, g2, b2));
+    }
+    for (; i < n; ++i) {
+      out[3 * i]     = r[i];
+      out[3 * i + 1] = g[i];
+      out[3 * i + 2] = b[i];
+    }
+  }
+
+  // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+}  // namespace kernels
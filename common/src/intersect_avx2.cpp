@@ -0,0 +1,70 @@
+// Compiled with -mavx2: four doubles per vector.
+#include "intersect_kernels.hpp"
+#include <cstdint>
+#include <immintrin.h>
+
+namespace {
+
+  struct LanesAvx2 {
+    using V                          = __m256d;
+    using M                          = __m256d;
+    static constexpr std::uint32_t W = 4;
+
+    static V set1(double x) { return _mm256_set1_pd(x); }
+
+    static V load(double const * p) { return _mm256_loadu_pd(p); }
+
+    static void store(double * p, V v) { _mm256_storeu_pd(p, v); }
+
+    static V add(V a, V b) { return _mm256_add_pd(a, b); }
+
+    static V sub(V a, V b) { return _mm256_sub_pd(a, b); }
+
+    static V mul(V a, V b) { return _mm256_mul_pd(a, b); }
+
+    static V div(V a, V b) { return _mm256_div_pd(a, b); }
+
+    static V sqrt(V a) { return _mm256_sqrt_pd(a); }
+
+    static V neg(V a) { return _mm256_xor_pd(a, _mm256_set1_pd(-0.0)); }
+
+    static V abs(V a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a); }
+
+    static M lt(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+
+    static M le(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_LE_OQ); }
+
+    static M ge(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_GE_OQ); }
+
+    // negated comparisons are true for NaN, like "not (a < b)" in the scalar code
+    static M nlt(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_NLT_UQ); }
+
+    static M nle(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_NLE_UQ); }
+
+    static M ngt(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_NGT_UQ); }
+
+    static M and_(M a, M b) { return _mm256_and_pd(a, b); }
+
+    static M or_(M a, M b) { return _mm256_or_pd(a, b); }
+
+    static V select(M m, V a, V b) { return _mm256_blendv_pd(b, a, m); }
+
+    static std::uint32_t bits(M m) { return static_cast<std::uint32_t>(_mm256_movemask_pd(m)); }
+
+    // lanes [0, n) of the current block
+    static M first(std::uint32_t n) {
+      return lt(_mm256_set_pd(3.0, 2.0, 1.0, 0.0), _mm256_set1_pd(static_cast<double>(n)));
+    }
+  };
+
+}  // namespace
+
+void closest_spheres_avx2(SimdRay const & ray, SphereView const & spheres, std::uint32_t begin,
+                          std::uint32_t count, HitCandidate & best) {
+  kernels::closest_spheres<LanesAvx2>(ray, spheres, begin, count, best);
+}
+
+void closest_cylinders_avx2(SimdRay const & ray, CylinderView const & cylinders,
+                            std::uint32_t begin, std::uint32_t count, HitCandidate & best) {
+  kernels::closest_cylinders<LanesAvx2>(ray, cylinders, begin, count, best);
+}
@@ -0,0 +1,75 @@
+// Compiled with -mavx512f: eight doubles per vector, comparisons yield k-masks.
+#include "intersect_kernels.hpp"
+#include <cstdint>
+#include <immintrin.h>
+
+namespace {
+
+  struct LanesAvx512 {
+    using V                          = __m512d;
+    using M                          = __mmask8;
+    static constexpr std::uint32_t W = 8;
+
+    static V set1(double x) { return _mm512_set1_pd(x); }
+
+    static V load(double const * p) { return _mm512_loadu_pd(p); }
+
+    static void store(double * p, V v) { _mm512_storeu_pd(p, v); }
+
+    static V add(V a, V b) { return _mm512_add_pd(a, b); }
+
+    static V sub(V a, V b) { return _mm512_sub_pd(a, b); }
+
+    static V mul(V a, V b) { return _mm512_mul_pd(a, b); }
+
+    static V div(V a, V b) { return _mm512_div_pd(a, b); }
+
+    // the zero-masked form: _mm512_sqrt_pd trips -Wmaybe-uninitialized on GCC 12 headers
+    static V sqrt(V a) { return _mm512_maskz_sqrt_pd(static_cast<M>(0xFFU), a); }
+
+    // sign flip through the integer unit: _mm512_xor_pd needs AVX512DQ
+    static V neg(V a) {
+      return _mm512_castsi512_pd(_mm512_xor_si512(
+          _mm512_castpd_si512(a), _mm512_castpd_si512(_mm512_set1_pd(-0.0))));
+    }
+
+    static V abs(V a) { return _mm512_abs_pd(a); }
+
+    static M lt(V a, V b) { return _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ); }
+
+    static M le(V a, V b) { return _mm512_cmp_pd_mask(a, b, _CMP_LE_OQ); }
+
+    static M ge(V a, V b) { return _mm512_cmp_pd_mask(a, b, _CMP_GE_OQ); }
+
+    // negated comparisons are true for NaN, like "not (a < b)" in the scalar code
+    static M nlt(V a, V b) { return _mm512_cmp_pd_mask(a, b, _CMP_NLT_UQ); }
+
+    static M nle(V a, V b) { return _mm512_cmp_pd_mask(a, b, _CMP_NLE_UQ); }
+
+    static M ngt(V a, V b) { return _mm512_cmp_pd_mask(a, b, _CMP_NGT_UQ); }
+
+    static M and_(M a, M b) { return static_cast<M>(a & b); }
+
+    static M or_(M a, M b) { return static_cast<M>(a | b); }
+
+    static V select(M m, V a, V b) { return _mm512_mask_blend_pd(m, b, a); }
+
+    static std::uint32_t bits(M m) { return m; }
+
+    // lanes [0, n) of the current block
+    static M first(std::uint32_t n) {
+      return n >= W ? static_cast<M>(0xFFU) : static_cast<M>((1U << n) - 1U);
+    }
+  };
+
+}  // namespace
+
+void closest_spheres_avx512(SimdRay const & ray, SphereView const & spheres,
+                            std::uint32_t begin, std::uint32_t count, HitCandidate & best) {
+  kernels::closest_spheres<LanesAvx512>(ray, spheres, begin, count, best);
+}
+
+void closest_cylinders_avx512(SimdRay const & ray, CylinderView const & cylinders,
+                              std::uint32_t begin, std::uint32_t count, HitCandidate & best) {
+  kernels::closest_cylinders<LanesAvx512>(ray, cylinders, begin, count, best);
+}
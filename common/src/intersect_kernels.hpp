@@ -0,0 +1,188 @@
+#pragma once
+// Lane-generic intersection kernels. Included by one translation unit per instruction
+// set; each provides a lane type L with W doubles per vector and the operations used
+// below. Only plain arithmetic and L:: calls are allowed here: anything from the
+// standard library would be instantiated with that file's ISA flags.
+#include "../include/intersect_simd.hpp"
+#include <cstdint>
+
+namespace kernels {
+  // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+  inline constexpr double INF = __builtin_inf();
+
+  // Replaces `best` with the lane that has the smallest (t, id), if it beats `best`.
+  template <class L>
+  inline void reduce(typename L::V t, typename L::M ok, std::uint32_t const * ids,
+                     std::uint32_t slot, HitCandidate & best) {
+    std::uint32_t const bits = L::bits(ok);
+    if (bits == 0U) {
+      return;
+    }
+    // NOLINTNEXTLINE(cppcoreguidelines-avoid-c-arrays,modernize-avoid-c-arrays)
+    alignas(64) double ts[L::W];
+    L::store(ts, t);
+    for (std::uint32_t lane = 0; lane < L::W; ++lane) {
+      if (((bits >> lane) & 1U) == 0U) {
+        continue;
+      }
+      // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+      double const tl        = ts[lane];
+      std::uint32_t const id = ids[lane];
+      if (tl < best.t or (tl == best.t and id < best.id)) {
+        best = {tl, id, slot + lane};
+      }
+    }
+  }
+
+  template <class L>
+  inline typename L::V dot(typename L::V ax, typename L::V ay, typename L::V az,
+                           typename L::V bx, typename L::V by, typename L::V bz) {
+    return L::add(L::add(L::mul(ax, bx), L::mul(ay, by)), L::mul(az, bz));
+  }
+
+  template <class L>
+  void closest_spheres(SimdRay const & r, SphereView const & s, std::uint32_t begin,
+                       std::uint32_t count, HitCandidate & best) {
+    using V            = typename L::V;
+    double const a     = r.dx * r.dx + r.dy * r.dy + r.dz * r.dz;
+    V const ox         = L::set1(r.ox);
+    V const oy         = L::set1(r.oy);
+    V const oz         = L::set1(r.oz);
+    V const dx         = L::set1(r.dx);
+    V const dy         = L::set1(r.dy);
+    V const dz         = L::set1(r.dz);
+    V const cuatro_a   = L::set1(4.0 * a);
+    V const inv_dos_a  = L::set1(1.0 / (2.0 * a));
+    V const menos_dos  = L::set1(-2.0);
+    V const eps        = L::set1(HIT_EPSILON);
+    V const cero       = L::set1(0.0);
+    V const infinito   = L::set1(INF);
+
+    for (std::uint32_t k = 0; k < count; k += L::W) {
+      std::uint32_t const slot = begin + k;
+      V const rcx              = L::sub(L::load(s.cx + slot), ox);
+      V const rcy              = L::sub(L::load(s.cy + slot), oy);
+      V const rcz              = L::sub(L::load(s.cz + slot), oz);
+      V const b                = L::mul(menos_dos, dot<L>(dx, dy, dz, rcx, rcy, rcz));
+      V const c    = L::sub(dot<L>(rcx, rcy, rcz, rcx, rcy, rcz), L::load(s.r2 + slot));
+      V const disc = L::sub(L::mul(b, b), L::mul(cuatro_a, c));
+      V const raiz = L::sqrt(disc);
+      V const nb   = L::neg(b);
+      V const d1   = L::mul(L::sub(nb, raiz), inv_dos_a);
+      V const d2   = L::mul(L::add(nb, raiz), inv_dos_a);
+
+      V const limite = L::set1(best.t);
+      auto const d1_ok = L::and_(L::ge(d1, eps), L::le(d1, limite));
+      auto const d2_ok = L::and_(L::ge(d2, eps), L::le(d2, limite));
+      V const t        = L::select(d1_ok, d1, d2);
+      auto const ok    = L::and_(L::and_(L::first(count - k), L::nlt(disc, cero)),
+                                 L::and_(L::or_(d1_ok, d2_ok), L::lt(t, infinito)));
+      reduce<L>(t, ok, s.id + slot, slot, best);
+    }
+  }
+
+  // Cap disc with centre (px, py, pz) and normal (nx, ny, nz); keeps the nearer of the
+  // cap and the current per-lane distance, like the sequential scalar tests.
+  template <class L>
+  inline void cap(SimdRay const & r, typename L::V px, typename L::V py, typename L::V pz,
+                  typename L::V nx, typename L::V ny, typename L::V nz, typename L::V radius,
+                  typename L::V & t, typename L::M & hay) {
+    using V          = typename L::V;
+    V const ox       = L::set1(r.ox);
+    V const oy       = L::set1(r.oy);
+    V const oz       = L::set1(r.oz);
+    V const dx       = L::set1(r.dx);
+    V const dy       = L::set1(r.dy);
+    V const dz       = L::set1(r.dz);
+    V const denom    = dot<L>(dx, dy, dz, nx, ny, nz);
+    V const dist     = L::div(dot<L>(L::sub(px, ox), L::sub(py, oy), L::sub(pz, oz), nx, ny, nz),
+                              denom);
+    V const qx       = L::sub(L::add(ox, L::mul(dx, dist)), px);
+    V const qy       = L::sub(L::add(oy, L::mul(dy, dist)), py);
+    V const qz       = L::sub(L::add(oz, L::mul(dz, dist)), pz);
+    V const longitud = L::sqrt(dot<L>(qx, qy, qz, qx, qy, qz));
+    auto const ok    = L::and_(L::and_(L::nle(L::abs(denom), L::set1(DENOM_EPSILON)),
+                                       L::ge(dist, L::set1(HIT_EPSILON))),
+                               L::and_(L::ngt(longitud, radius), L::lt(dist, t)));
+    t   = L::select(ok, dist, t);
+    hay = L::or_(hay, ok);
+  }
+
+  template <class L>
+  void closest_cylinders(SimdRay const & r, CylinderView const & c, std::uint32_t begin,
+                         std::uint32_t count, HitCandidate & best) {
+    using V           = typename L::V;
+    V const ox        = L::set1(r.ox);
+    V const oy        = L::set1(r.oy);
+    V const oz        = L::set1(r.oz);
+    V const dx        = L::set1(r.dx);
+    V const dy        = L::set1(r.dy);
+    V const dz        = L::set1(r.dz);
+    V const dos       = L::set1(2.0);
+    V const cuatro    = L::set1(4.0);
+    V const eps       = L::set1(HIT_EPSILON);
+    V const eps_denom = L::set1(DENOM_EPSILON);
+    V const cero      = L::set1(0.0);
+    V const infinito  = L::set1(INF);
+
+    for (std::uint32_t k = 0; k < count; k += L::W) {
+      std::uint32_t const slot = begin + k;
+      V const cx               = L::load(c.cx + slot);
+      V const cy               = L::load(c.cy + slot);
+      V const cz               = L::load(c.cz + slot);
+      V const ax               = L::load(c.ax + slot);
+      V const ay               = L::load(c.ay + slot);
+      V const az               = L::load(c.az + slot);
+      V const radius           = L::load(c.radius + slot);
+
+      // superficie curva: componentes perpendiculares al eje
+      V const rcx  = L::sub(ox, cx);
+      V const rcy  = L::sub(oy, cy);
+      V const rcz  = L::sub(oz, cz);
+      V const p_rc = dot<L>(rcx, rcy, rcz, ax, ay, az);
+      V const opx  = L::sub(rcx, L::mul(ax, p_rc));
+      V const opy  = L::sub(rcy, L::mul(ay, p_rc));
+      V const opz  = L::sub(rcz, L::mul(az, p_rc));
+      V const p_d  = dot<L>(dx, dy, dz, ax, ay, az);
+      V const dpx  = L::sub(dx, L::mul(ax, p_d));
+      V const dpy  = L::sub(dy, L::mul(ay, p_d));
+      V const dpz  = L::sub(dz, L::mul(az, p_d));
+      V const qa   = dot<L>(dpx, dpy, dpz, dpx, dpy, dpz);
+      V const qb   = L::mul(dos, dot<L>(opx, opy, opz, dpx, dpy, dpz));
+      V const qc   = L::sub(dot<L>(opx, opy, opz, opx, opy, opz), L::load(c.r2 + slot));
+      V const disc = L::sub(L::mul(qb, qb), L::mul(L::mul(cuatro, qa), qc));
+      V const dist = L::div(L::sub(L::neg(qb), L::sqrt(disc)), L::mul(dos, qa));
+      V const icx  = L::sub(L::add(ox, L::mul(dx, dist)), cx);
+      V const icy  = L::sub(L::add(oy, L::mul(dy, dist)), cy);
+      V const icz  = L::sub(L::add(oz, L::mul(dz, dist)), cz);
+      V const proy = dot<L>(icx, icy, icz, ax, ay, az);
+      V const h    = L::load(c.half_height + slot);
+      auto hay     = L::and_(L::and_(L::nlt(disc, cero), L::nle(L::abs(qa), eps_denom)),
+                             L::and_(L::ge(dist, eps),
+                                     L::and_(L::nlt(proy, L::neg(h)), L::ngt(proy, h))));
+      V t          = L::select(hay, dist, infinito);
+
+      cap<L>(r, L::load(c.lox + slot), L::load(c.loy + slot), L::load(c.loz + slot), L::neg(ax),
+             L::neg(ay), L::neg(az), radius, t, hay);
+      cap<L>(r, L::load(c.hix + slot), L::load(c.hiy + slot), L::load(c.hiz + slot), ax, ay, az,
+             radius, t, hay);
+
+      auto const ok = L::and_(L::and_(L::first(count - k), hay),
+                              L::and_(L::le(t, L::set1(best.t)), L::lt(t, infinito)));
+      reduce<L>(t, ok, c.id + slot, slot, best);
+    }
+  }
+  // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+}  // namespace kernels
+
+// Entry points of the ISA-specific translation units.
+void closest_spheres_avx2(SimdRay const & ray, SphereView const & spheres, std::uint32_t begin,
+                          std::uint32_t count, HitCandidate & best);
+void closest_cylinders_avx2(SimdRay const & ray, CylinderView const & cylinders,
+                            std::uint32_t begin, std::uint32_t count, HitCandidate & best);
+void closest_spheres_avx512(SimdRay const & ray, SphereView const & spheres, std::uint32_t begin,
+                            std::uint32_t count, HitCandidate & best);
+void closest_cylinders_avx512(SimdRay const & ray, CylinderView const & cylinders,
+                              std::uint32_t begin, std::uint32_t count, HitCandidate & best);
@@ -0,0 +1,108 @@
+#include "../include/intersect_simd.hpp"
+#include "intersect_kernels.hpp"
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+namespace {
+
+  // One lane; the fallback for CPUs without AVX2 and for non-x86 builds.
+  struct LanesScalar {
+    using V                          = double;
+    using M                          = bool;
+    static constexpr std::uint32_t W = 1;
+
+    static V set1(double x) { return x; }
+
+    static V load(double const * p) { return *p; }
+
+    static void store(double * p, V v) { *p = v; }
+
+    static V add(V a, V b) { return a + b; }
+
+    static V sub(V a, V b) { return a - b; }
+
+    static V mul(V a, V b) { return a * b; }
+
+    static V div(V a, V b) { return a / b; }
+
+    static V sqrt(V a) { return std::sqrt(a); }
+
+    static V neg(V a) { return -a; }
+
+    static V abs(V a) { return std::abs(a); }
+
+    static M lt(V a, V b) { return a < b; }
+
+    static M le(V a, V b) { return a <= b; }
+
+    static M ge(V a, V b) { return a >= b; }
+
+    static M nlt(V a, V b) { return not(a < b); }
+
+    static M nle(V a, V b) { return not(a <= b); }
+
+    static M ngt(V a, V b) { return not(a > b); }
+
+    static M and_(M a, M b) { return a and b; }
+
+    static M or_(M a, M b) { return a or b; }
+
+    static V select(M m, V a, V b) { return m ? a : b; }
+
+    static std::uint32_t bits(M m) { return m ? 1U : 0U; }
+
+    static M first(std::uint32_t n) { return n > 0U; }
+  };
+
+  void closest_spheres_scalar(SimdRay const & ray, SphereView const & spheres,
+                              std::uint32_t begin, std::uint32_t count, HitCandidate & best) {
+    kernels::closest_spheres<LanesScalar>(ray, spheres, begin, count, best);
+  }
+
+  void closest_cylinders_scalar(SimdRay const & ray, CylinderView const & cylinders,
+                                std::uint32_t begin, std::uint32_t count, HitCandidate & best) {
+    kernels::closest_cylinders<LanesScalar>(ray, cylinders, begin, count, best);
+  }
+
+  // Scalar first, then each wider set the running CPU supports.
+  struct KernelTable {
+    std::array<IntersectKernels, 3> entries;
+    std::uint32_t count;
+  };
+
+  KernelTable detect_kernels() {
+    KernelTable table{};
+    table.entries.at(table.count++) = {closest_spheres_scalar, closest_cylinders_scalar, "scalar"};
+#if defined(RENDER_X86_KERNELS)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+      table.entries.at(table.count++) = {closest_spheres_avx2, closest_cylinders_avx2, "avx2"};
+    }
+    if (__builtin_cpu_supports("avx512f")) {
+      table.entries.at(table.count++) = {closest_spheres_avx512, closest_cylinders_avx512,
+                                         "avx512"};
+    }
+#endif
+    return table;
+  }
+
+  KernelTable const & kernel_table() {
+    static KernelTable const table = detect_kernels();
+    return table;
+  }
+
+}  // namespace
+
+IntersectKernels const & intersect_kernels() {
+  KernelTable const & table = kernel_table();
+  return table.entries.at(table.count - 1);
+}
+
+std::uint32_t num_intersect_kernels() {
+  return kernel_table().count;
+}
+
+IntersectKernels const & intersect_kernels(std::uint32_t index) {
+  return kernel_table().entries.at(index);
+}
@@ -0,0 +1,86 @@
+#include "../include/mapped_file.hpp"
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+  [[noreturn]] void fail_errno(char const * call, int error) {
+    throw std::runtime_error(std::string(call) + " failed: " + std::strerror(error));
+  }
+
+  // Reads fd to the end, for files that cannot be mapped.
+  std::string read_all(int fd) {
+    std::string out;
+    constexpr std::size_t CHUNK = std::size_t{1} << 16U;
+    std::size_t used = 0;
+    for (;;) {
+      out.resize(used + CHUNK);
+      ssize_t const got = ::read(fd, out.data() + used, CHUNK);
+      if (got < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        fail_errno("read", errno);
+      }
+      if (got == 0) {
+        break;
+      }
+      used += static_cast<std::size_t>(got);
+    }
+    out.resize(used);
+    return out;
+  }
+
+}  // namespace
+
+MappedFile::MappedFile(std::string const & path, FileAccess access) {
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-vararg)
+  int const fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    fail_errno("open", errno);
+  }
+  struct stat info{};
+  if (::fstat(fd, &info) != 0) {
+    int const error = errno;
+    (void) ::close(fd);
+    fail_errno("fstat", error);
+  }
+
+  if (S_ISREG(info.st_mode) and info.st_size > 0) {
+    size_               = static_cast<std::size_t>(info.st_size);
+    void * const mapped = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapped != MAP_FAILED) {
+      (void) ::madvise(mapped, size_,
+                       access == FileAccess::sequential ? MADV_SEQUENTIAL : MADV_WILLNEED);
+      data_   = static_cast<char const *>(mapped);
+      mapped_ = true;
+      (void) ::close(fd);
+      return;
+    }
+  }
+
+  try {
+    buffer_ = read_all(fd);
+  } catch (...) {
+    (void) ::close(fd);
+    throw;
+  }
+  (void) ::close(fd);
+  data_ = buffer_.data();
+  size_ = buffer_.size();
+}
+
+MappedFile::~MappedFile() {
+  if (mapped_) {
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+    (void) ::munmap(const_cast<char *>(data_), size_);
+  }
+}
@@ -1,26 +1,33 @@
 #include "ppm_writer.hpp"
+#include "../include/framebuffer_soa.hpp"
+#include "../include/rayos.hpp"
+#include "interleave_rgb.hpp"
 
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <climits>
 #include <cerrno>
+#include <cstddef>
 #include <cstdint>
 #include <cstdio>
 #include <cstring>
+#include <fstream>
 #include <memory>
 #include <print>
-#include <sstream>
 #include <stdexcept>
 #include <string>
 #include <vector>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
 #include <oneapi/tbb/blocked_range.h>
 #include <oneapi/tbb/parallel_for.h>
 #include <oneapi/tbb/partitioner.h>
 
-struct FramebufferSOA {
-  std::vector<std::uint8_t> R;
-  std::vector<std::uint8_t> G;
-  std::vector<std::uint8_t> B;
-};
-
 namespace {
 
   // deleter personalizado para FILE* usado con unique_ptr
@@ -51,43 +58,420 @@ namespace {
     std::println(archivo, "P3\n{} {}\n255", ancho, alto);
   }
 
+  // ---------- P3 ----------
+
+  // texto decimal de cada byte, relleno a 4 caracteres para copiarlo de una vez
+  struct Decimal {
+    std::array<char, 4> texto;
+    std::uint8_t longitud;
+  };
+
+  constexpr std::array<Decimal, 256> TABLA_DECIMAL = [] {
+    std::array<Decimal, 256> tabla{};
+    for (std::size_t v = 0; v < tabla.size(); ++v) {
+      auto & d = tabla.at(v);
+      if (v >= 100) {
+        d.texto    = {char('0' + v / 100), char('0' + v / 10 % 10), char('0' + v % 10), ' '};
+        d.longitud = 3;
+      } else if (v >= 10) {
+        d.texto    = {char('0' + v / 10), char('0' + v % 10), ' ', ' '};
+        d.longitud = 2;
+      } else {
+        d.texto    = {char('0' + v), ' ', ' ', ' '};
+        d.longitud = 1;
+      }
+    }
+    return tabla;
+  }();
+
+  // bandas de filas que se formatean en paralelo; tambien acota las iovec de writev
+  constexpr std::size_t MAX_BANDAS_P3 = 256;
+  // la ultima copia de 4 bytes puede pasar del final del texto
+  constexpr std::size_t HOLGURA_P3 = 4;
+
+  struct BandaTexto {
+    std::unique_ptr<char[]> datos;  // NOLINT(cppcoreguidelines-avoid-c-arrays)
+    std::size_t tam = 0;
+  };
+
+  // pixel i de cada layout, para que el formateo P3 sirva a los dos
+  [[nodiscard]] Pixel leer_pixel(FramebufferSOA const & fb, std::size_t i) {
+    return {fb.R[i], fb.G[i], fb.B[i]};
+  }
+
+  [[nodiscard]] Pixel leer_pixel(std::vector<Pixel> const & fb, std::size_t i) { return fb[i]; }
+
+  // caracteres de la linea "r g b\n" de un pixel
+  [[nodiscard]] std::size_t longitud_linea(Pixel px) {
+    return std::size_t{TABLA_DECIMAL.at(px.r).longitud} + TABLA_DECIMAL.at(px.g).longitud +
+           TABLA_DECIMAL.at(px.b).longitud + 3;
+  }
+
+  // formatea los pixeles [desde, hasta) como lineas "r g b\n" en un buffer de tamanyo exacto
+  template <typename Imagen>
+  void formatear_banda(Imagen const & fb, std::size_t desde, std::size_t hasta,
+                       BandaTexto & banda) {
+    std::size_t tam = 0;
+    for (std::size_t i = desde; i < hasta; ++i) {
+      tam += longitud_linea(leer_pixel(fb, i));
+    }
+    banda.datos = std::make_unique_for_overwrite<char[]>(tam + HOLGURA_P3);  // NOLINT
+    banda.tam   = tam;
+
+    char * p = banda.datos.get();
+    // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    auto const copiar = [&p](std::uint8_t v, char separador) {
+      auto const & d = TABLA_DECIMAL.at(v);
+      std::memcpy(p, d.texto.data(), d.texto.size());
+      p    += d.longitud;
+      *p++  = separador;
+    };
+    for (std::size_t i = desde; i < hasta; ++i) {
+      Pixel const px = leer_pixel(fb, i);
+      copiar(px.r, ' ');
+      copiar(px.g, ' ');
+      copiar(px.b, '\n');
+    }
+    // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  }
+
+  // escribe las bandas en orden con writev, en grupos de IOV_MAX y reintentando las
+  // escrituras parciales
+  void escribir_bandas(int fd, std::vector<BandaTexto> const & bandas) {
+    std::vector<iovec> vec;
+    vec.reserve(bandas.size());
+    for (auto const & banda : bandas) {
+      if (banda.tam > 0) {
+        vec.push_back({banda.datos.get(), banda.tam});
+      }
+    }
+    std::size_t primero = 0;
+    while (primero < vec.size()) {
+      auto const cuantos = static_cast<int>(std::min<std::size_t>(vec.size() - primero, IOV_MAX));
+      ssize_t escritos   = ::writev(fd, &vec[primero], cuantos);
+      if (escritos < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        throw std::runtime_error(std::string("writev fallo: ") + std::strerror(errno));
+      }
+      // avanza por las iovec completas y recorta la que quedo a medias
+      while (primero < vec.size() and static_cast<std::size_t>(escritos) >= vec[primero].iov_len) {
+        escritos -= static_cast<ssize_t>(vec[primero].iov_len);
+        ++primero;
+      }
+      if (primero < vec.size() and escritos > 0) {
+        vec[primero].iov_base = static_cast<char *>(vec[primero].iov_base) + escritos;
+        vec[primero].iov_len -= static_cast<std::size_t>(escritos);
+      }
+    }
+  }
+
+  // ---------- P6 ----------
+
+  // bytes de cada bloque que se entrelaza y se escribe de una vez en P6
+  constexpr std::size_t TAM_BLOQUE_P6 = std::size_t{1} << 20U;
+
+  // entrelazado escalar, para CPUs sin SSSE3 y otras arquitecturas
+  void entrelazar_rgb_escalar(std::uint8_t const * r, std::uint8_t const * g,
+                              std::uint8_t const * b, std::size_t n, std::uint8_t * out) {
+    // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    for (std::size_t i = 0; i < n; ++i) {
+      out[3 * i]     = r[i];
+      out[3 * i + 1] = g[i];
+      out[3 * i + 2] = b[i];
+    }
+    // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  }
+
+  // elige el kernel de entrelazado una vez segun la CPU
+  [[nodiscard]] kernels::InterleaveRgbFn kernel_entrelazado() {
+#if defined(RENDER_X86_KERNELS)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("ssse3")) {
+      return kernels::interleave_rgb_ssse3;
+    }
+#endif
+    return entrelazar_rgb_escalar;
+  }
+
+  // escribe encabezado PPM con formato P6
+  void escribir_encabezado_p6(std::FILE * archivo, int ancho, int alto) {
+    std::print(archivo, "P6\n{} {}\n255\n", ancho, alto);
+  }
+
+  // escribe en fd el texto P3 de las primeras 'filas' filas de fb. Cada banda de filas mide
+  // primero su texto exacto con la tabla de longitudes, reserva un buffer de ese tamanyo y
+  // lo rellena copiando de la tabla de decimales; despues todas las bandas salen con
+  // writev en orden de fila
+  template <typename Imagen>
+  void escribir_pixeles_p3(int fd, Imagen const & fb, std::size_t ancho, std::size_t filas) {
+    std::size_t const num_bandas      = std::min(filas, MAX_BANDAS_P3);
+    std::size_t const filas_por_banda = num_bandas == 0 ? 0 : (filas + num_bandas - 1) / num_bandas;
+    std::vector<BandaTexto> bandas(num_bandas);
+
+    oneapi::tbb::parallel_for(
+        oneapi::tbb::blocked_range<std::size_t>(0, num_bandas),
+        [&](oneapi::tbb::blocked_range<std::size_t> const & range) {
+          for (auto banda = range.begin(); banda != range.end(); ++banda) {
+            std::size_t const desde = std::min(banda * filas_por_banda, filas) * ancho;
+            std::size_t const hasta = std::min((banda + 1) * filas_por_banda, filas) * ancho;
+            formatear_banda(fb, desde, hasta, bandas[banda]);
+          }
+        },
+        oneapi::tbb::simple_partitioner{});
+
+    escribir_bandas(fd, bandas);
+  }
+
+  // escribe los 'total' primeros pixeles de fb en binario: los planos se entrelazan por
+  // bloques de TAM_BLOQUE_P6 bytes en un buffer reutilizado y cada bloque sale con un solo
+  // fwrite
+  void escribir_pixeles_p6(std::FILE * archivo, FramebufferSOA const & fb, std::size_t total) {
+    static kernels::InterleaveRgbFn const entrelazar = kernel_entrelazado();
+
+    std::size_t const por_bloque = TAM_BLOQUE_P6 / 3;
+    std::vector<std::uint8_t> bloque(3 * std::min(total, por_bloque));
+    for (std::size_t i = 0; i < total; i += por_bloque) {
+      std::size_t const n = std::min(por_bloque, total - i);
+      entrelazar(fb.R.data() + i, fb.G.data() + i, fb.B.data() + i, n, bloque.data());
+      if (std::fwrite(bloque.data(), 1, 3 * n, archivo) != 3 * n) {
+        throw std::runtime_error(std::string("fwrite fallo: ") + std::strerror(errno));
+      }
+    }
+  }
+
 }  // namespace
 
-// escribe framebuffer SOA a archivo PPM (con paralelismo seguro)
+// escribe framebuffer SOA a archivo PPM P3 (ver escribir_pixeles_p3)
 bool writePPM_SOA(std::string const & ruta, FramebufferSOA const & fb, int ancho, int alto) {
   auto const archivo = abrir_archivo(ruta);
   escribir_encabezado(archivo.get(), ancho, alto);
+  if (std::fflush(archivo.get()) != 0) {
+    throw std::runtime_error(std::string("fflush fallo: ") + std::strerror(errno));
+  }
+  escribir_pixeles_p3(fileno(archivo.get()), fb, static_cast<std::size_t>(ancho),
+                      static_cast<std::size_t>(alto));
+  return true;
+}
 
-  // buffer de texto por fila: cada hilo escribe en filas distintas (sin carreras)
-  std::vector<std::string> filas_texto(static_cast<std::size_t>(alto));
+// escribe framebuffer SOA a archivo PPM binario (ver escribir_pixeles_p6)
+bool writePPM_P6_SOA(std::string const & ruta, FramebufferSOA const & fb, int ancho, int alto) {
+  auto const archivo = abrir_archivo(ruta);
+  escribir_encabezado_p6(archivo.get(), ancho, alto);
+  escribir_pixeles_p6(archivo.get(), fb,
+                      static_cast<std::size_t>(ancho) * static_cast<std::size_t>(alto));
+  return true;
+}
 
-  oneapi::tbb::parallel_for(
-      oneapi::tbb::blocked_range<int>(0, alto),
-      [&](oneapi::tbb::blocked_range<int> const & range) {
-        for (int fila = range.begin(); fila != range.end(); ++fila) {
-          std::ostringstream oss;
+// escribe el color lineal fila a fila de abajo arriba, como pide PFM; la escala negativa
+// de la cabecera indica little endian
+bool writePFM_SOA(std::string const & ruta, FramebufferSOA const & fb, int ancho, int alto) {
+  if (fb.linealR.empty()) {
+    throw std::runtime_error("PFM sin planos float");
+  }
+  auto const archivo = abrir_archivo(ruta);
+  std::print(archivo.get(), "PF\n{} {}\n{}\n", ancho, alto,
+             std::endian::native == std::endian::little ? "-1.0" : "1.0");
 
-          auto const indice_fila = static_cast<std::size_t>(fila) * static_cast<std::size_t>(ancho);
+  auto const ancho_u = static_cast<std::size_t>(ancho);
+  std::vector<float> fila_rgb(3 * ancho_u);
+  for (auto fila = static_cast<std::size_t>(alto); fila-- > 0;) {
+    std::size_t const base = fila * fb.pasoLineal;
+    for (std::size_t col = 0; col < ancho_u; ++col) {
+      fila_rgb[3 * col]     = fb.linealR[base + col];
+      fila_rgb[3 * col + 1] = fb.linealG[base + col];
+      fila_rgb[3 * col + 2] = fb.linealB[base + col];
+    }
+    if (std::fwrite(fila_rgb.data(), sizeof(float), fila_rgb.size(), archivo.get()) !=
+        fila_rgb.size()) {
+      throw std::runtime_error(std::string("fwrite fallo: ") + std::strerror(errno));
+    }
+  }
+  return true;
+}
 
-          for (int col = 0; col < ancho; ++col) {
-            auto const idx = indice_fila + static_cast<std::size_t>(col);
-            // mismo formato que escribir_triplete: "r g b\n"
-            oss << static_cast<unsigned>(fb.R[idx]) << ' ' << static_cast<unsigned>(fb.G[idx])
-                << ' ' << static_cast<unsigned>(fb.B[idx]) << '\n';
-          }
+void readPFM_SOA(std::string const & ruta, FramebufferSOA & fb, int & ancho, int & alto) {
+  std::ifstream entrada(ruta, std::ios::binary);
+  if (!entrada) {
+    throw std::runtime_error("no se puede abrir " + ruta);
+  }
+  std::string tipo;
+  double escala = 0.0;
+  entrada >> tipo >> ancho >> alto >> escala;
+  if (!entrada or tipo != "PF" or ancho <= 0 or alto <= 0 or escala == 0.0) {
+    throw std::runtime_error("PFM en color invalido: " + ruta);
+  }
+  entrada.get();  // un unico separador antes de los datos
 
-          filas_texto[static_cast<std::size_t>(fila)] = std::move(oss).str();
-        }
-      },
-      oneapi::tbb::simple_partitioner{});  // puedes cambiar a static_partitioner o auto_partitioner
-
-  // escritura secuencial al FILE* en el orden correcto de filas
-  for (int fila = 0; fila < alto; ++fila) {
-    std::string const & linea = filas_texto[static_cast<std::size_t>(fila)];
-    if (!linea.empty()) {
-      // cert-err33-c: ignoramos explícitamente el valor devuelto
-      (void) std::fwrite(linea.data(), 1, linea.size(), archivo.get());  // NOLINT(cert-err33-c)
+  bool const little   = escala < 0.0;
+  bool const invertir = little != (std::endian::native == std::endian::little);
+  auto const ancho_u  = static_cast<std::size_t>(ancho);
+  initLinealSOA(fb, ancho, alto);
+  std::vector<std::uint32_t> fila_rgb(3 * ancho_u);
+  for (auto fila = static_cast<std::size_t>(alto); fila-- > 0;) {
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    entrada.read(reinterpret_cast<char *>(fila_rgb.data()),
+                 static_cast<std::streamsize>(fila_rgb.size() * sizeof(float)));
+    if (!entrada) {
+      throw std::runtime_error("PFM truncado: " + ruta);
+    }
+    std::size_t const base = fila * fb.pasoLineal;
+    for (std::size_t col = 0; col < ancho_u; ++col) {
+      auto valor = [&](std::size_t i) {
+        return std::bit_cast<float>(invertir ? std::byteswap(fila_rgb[i]) : fila_rgb[i]);
+      };
+      fb.linealR[base + col] = valor(3 * col);
+      fb.linealG[base + col] = valor(3 * col + 1);
+      fb.linealB[base + col] = valor(3 * col + 2);
     }
   }
+}
+
+ImageFormat image_format_from_path(std::string const & ruta) {
+  if (ruta.ends_with(".pnm")) {
+    return ImageFormat::p6;
+  }
+  return ruta.ends_with(".pfm") ? ImageFormat::pfm : ImageFormat::p3;
+}
+
+bool writeImage_SOA(std::string const & ruta, FramebufferSOA const & fb, int ancho, int alto,
+                    ImageFormat formato) {
+  if (formato == ImageFormat::p6) {
+    return writePPM_P6_SOA(ruta, fb, ancho, alto);
+  }
+  if (formato == ImageFormat::pfm) {
+    return writePFM_SOA(ruta, fb, ancho, alto);
+  }
+  return writePPM_SOA(ruta, fb, ancho, alto);
+}
+
+// escribe framebuffer AOS a archivo PPM P3, con el mismo formateo por bandas que SOA
+bool writePPM_AOS(std::string const & ruta, std::vector<Pixel> const & fb, int ancho, int alto) {
+  auto const archivo = abrir_archivo(ruta);
+  escribir_encabezado(archivo.get(), ancho, alto);
+  if (std::fflush(archivo.get()) != 0) {
+    throw std::runtime_error(std::string("fflush fallo: ") + std::strerror(errno));
+  }
+  escribir_pixeles_p3(fileno(archivo.get()), fb, static_cast<std::size_t>(ancho),
+                      static_cast<std::size_t>(alto));
   return true;
 }
+
+// escribe framebuffer AOS a archivo PPM binario: los pixeles ya estan entrelazados en el
+// orden de P6, asi que salen con un solo fwrite
+bool writePPM_P6_AOS(std::string const & ruta, std::vector<Pixel> const & fb, int ancho,
+                     int alto) {
+  static_assert(sizeof(Pixel) == 3);
+  auto const archivo = abrir_archivo(ruta);
+  escribir_encabezado_p6(archivo.get(), ancho, alto);
+  std::size_t const total = static_cast<std::size_t>(ancho) * static_cast<std::size_t>(alto);
+  if (std::fwrite(fb.data(), sizeof(Pixel), total, archivo.get()) != total) {
+    throw std::runtime_error(std::string("fwrite fallo: ") + std::strerror(errno));
+  }
+  return true;
+}
+
+bool writeImage_AOS(std::string const & ruta, std::vector<Pixel> const & fb, int ancho,
+                    int alto, ImageFormat formato) {
+  if (formato == ImageFormat::pfm) {
+    throw std::runtime_error("PFM sin planos float");
+  }
+  if (formato == ImageFormat::p6) {
+    return writePPM_P6_AOS(ruta, fb, ancho, alto);
+  }
+  return writePPM_AOS(ruta, fb, ancho, alto);
+}
+
+BandWriter::BandWriter(std::string const & ruta, int ancho, int alto, ImageFormat formato)
+    : ancho_(static_cast<std::size_t>(ancho)), formato_(formato) {
+  if (formato_ == ImageFormat::pfm) {
+    // PFM guarda las filas de abajo arriba: no se puede escribir en orden de render; se
+    // rechaza antes de crear el archivo
+    throw std::runtime_error("PFM no se puede escribir por bandas");
+  }
+  // el destructor no corre si el constructor lanza: el archivo queda en un FilePtr hasta
+  // que el encabezado esta escrito
+  FilePtr archivo = abrir_archivo(ruta);
+  if (formato_ == ImageFormat::p6) {
+    escribir_encabezado_p6(archivo.get(), ancho, alto);
+  } else {
+    escribir_encabezado(archivo.get(), ancho, alto);
+    if (std::fflush(archivo.get()) != 0) {
+      throw std::runtime_error(std::string("fflush fallo: ") + std::strerror(errno));
+    }
+  }
+  archivo_ = archivo.release();
+}
+
+BandWriter::~BandWriter() { FileCloser{}(archivo_); }
+
+void BandWriter::write(FramebufferSOA const & banda) {
+  if (formato_ == ImageFormat::p6) {
+    escribir_pixeles_p6(archivo_, banda, banda.R.size());
+    return;
+  }
+  escribir_pixeles_p3(fileno(archivo_), banda, ancho_, banda.R.size() / ancho_);
+}
+
+void BandWriter::close() {
+  if (archivo_ == nullptr) {
+    return;
+  }
+  std::FILE * const archivo = archivo_;
+  archivo_                  = nullptr;
+  // NOLINTNEXTLINE(cppcoreguidelines-owning-memory)
+  if (std::fclose(archivo) != 0) {
+    throw std::runtime_error(std::string("fclose fallo: ") + std::strerror(errno));
+  }
+}
+
+MappedP6Image::MappedP6Image(std::string const & ruta, int ancho, int alto) {
+  std::string const encabezado =
+      "P6\n" + std::to_string(ancho) + " " + std::to_string(alto) + "\n255\n";
+  cabecera_ = encabezado.size();
+  tamanyo_  = cabecera_ + 3 * static_cast<std::size_t>(ancho) * static_cast<std::size_t>(alto);
+
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-vararg)
+  fd_ = ::open(ruta.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0666);
+  if (fd_ < 0) {
+    throw std::runtime_error(std::string("open fallo: ") + std::strerror(errno));
+  }
+  if (::ftruncate(fd_, static_cast<off_t>(tamanyo_)) != 0) {
+    int const error = errno;
+    (void) ::close(fd_);
+    throw std::runtime_error(std::string("ftruncate fallo: ") + std::strerror(error));
+  }
+  void * const mapa = ::mmap(nullptr, tamanyo_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+  if (mapa == MAP_FAILED) {
+    int const error = errno;
+    (void) ::close(fd_);
+    throw std::runtime_error(std::string("mmap fallo: ") + std::strerror(error));
+  }
+  datos_ = static_cast<std::uint8_t *>(mapa);
+  std::memcpy(datos_, encabezado.data(), cabecera_);
+}
+
+MappedP6Image::~MappedP6Image() {
+  if (datos_ != nullptr) {
+    (void) ::munmap(datos_, tamanyo_);
+    (void) ::close(fd_);
+  }
+}
+
+// las paginas modificadas quedan en la cache del sistema y llegan al disco solas, igual
+// que con fwrite: no se fuerza msync
+void MappedP6Image::close() {
+  if (datos_ == nullptr) {
+    return;
+  }
+  int const fallo_munmap = ::munmap(datos_, tamanyo_);
+  int const error_munmap = errno;
+  datos_                 = nullptr;
+  if (::close(fd_) != 0) {
+    throw std::runtime_error(std::string("close fallo: ") + std::strerror(errno));
+  }
+  if (fallo_munmap != 0) {
+    throw std::runtime_error(std::string("munmap fallo: ") + std::strerror(error_munmap));
+  }
+}
@@ -1,63 +1,40 @@
 #include "../include/rayos.hpp"
-#include "../../soa/src/framebuffer_soa.hpp"
+#include "../include/framebuffer_soa.hpp"
+#include "../include/bvh.hpp"
 #include "../include/camera.hpp"
+#include "../include/counter_rng.hpp"
+#include "../include/intersect_simd.hpp"
+#include "../include/render_scene.hpp"
+#include "../include/sampler.hpp"
 #include "../include/scene.hpp"
+#include "../include/tiles.hpp"
+#include "../include/tonemap.hpp"
+#include "../include/vector3.hpp"
 #include <algorithm>
 #include <array>
+#include <atomic>
+#include <chrono>
 #include <cmath>
 #include <cstddef>
 #include <cstdint>
 #include <limits>
-#include <oneapi/tbb/blocked_range2d.h>
-#include <oneapi/tbb/enumerable_thread_specific.h>
+#include <vector>
+#include <oneapi/tbb/blocked_range.h>
 #include <oneapi/tbb/parallel_for.h>
+#include <oneapi/tbb/parallel_pipeline.h>
 #include <oneapi/tbb/partitioner.h>
-#include <random>
+#include <oneapi/tbb/task_arena.h>
 
 namespace {
 
-  constexpr double EPSILON_MAGNITUD     = 1e-12;
-  constexpr double EPSILON_INTERSECCION = 1e-3;
-  constexpr double EPSILON_DENOMINADOR  = 1e-8;
-  constexpr double VALOR_MIN_COLOR      = 0.0;
-  constexpr double VALOR_MAX_COLOR      = 255.0;
+  constexpr double EPSILON_INTERSECCION = HIT_EPSILON;
+  constexpr double EPSILON_DENOMINADOR  = DENOM_EPSILON;
   constexpr double COLOR_BLANCO         = 1.0;
   constexpr double COLOR_NEGRO          = 0.0;
   constexpr double COEF_CUADRATICA      = 2.0;
   constexpr double COEF_CUADRATICA_INV  = 4.0;
-  constexpr double NEGATIVO             = -1.0;
   constexpr double VECTOR_PEQUENYO      = 1e-8;
-
-  [[nodiscard]] inline std::array<double, 3> normalize(std::array<double, 3> const & a) {
-    double const magnitud = std::sqrt(a[0] * a[0] + a[1] * a[1] + a[2] * a[2]);
-    if (magnitud > EPSILON_MAGNITUD) {
-      return {a[0] / magnitud, a[1] / magnitud, a[2] / magnitud};
-    }
-    return {COLOR_NEGRO, COLOR_NEGRO, COLOR_NEGRO};
-  }
-
-  [[nodiscard]] inline double dot(std::array<double, 3> const & a,
-                                  std::array<double, 3> const & b) {
-    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
-  }
-
-  [[nodiscard]] inline std::array<double, 3> sub(std::array<double, 3> const & a,
-                                                 std::array<double, 3> const & b) {
-    return {a[0] - b[0], a[1] - b[1], a[2] - b[2]};
-  }
-
-  [[nodiscard]] inline std::array<double, 3> add(std::array<double, 3> const & a,
-                                                 std::array<double, 3> const & b) {
-    return {a[0] + b[0], a[1] + b[1], a[2] + b[2]};
-  }
-
-  [[nodiscard]] inline std::array<double, 3> mul(std::array<double, 3> const & a, double escalar) {
-    return {a[0] * escalar, a[1] * escalar, a[2] * escalar};
-  }
-
-  [[nodiscard]] inline double length(std::array<double, 3> const & a) {
-    return std::sqrt(a[0] * a[0] + a[1] * a[1] + a[2] * a[2]);
-  }
+  constexpr std::size_t TAM_PILA_BVH    = 64;
 
   [[nodiscard]] inline std::array<double, 3> perp_to_axis(std::array<double, 3> const & v,
                                                           std::array<double, 3> const & a) {
@@ -65,11 +42,6 @@ namespace {
     return sub(v, mul(a, proyeccion));
   }
 
-  [[nodiscard]] inline std::uint8_t color_a_byte(double valor) {
-    double const clamped = std::clamp(valor * VALOR_MAX_COLOR, VALOR_MIN_COLOR, VALOR_MAX_COLOR);
-    return static_cast<std::uint8_t>(clamped);
-  }
-
   [[nodiscard]] inline bool vector_demasiado_pequenyo(std::array<double, 3> const & v) {
     return std::abs(v[0]) < VECTOR_PEQUENYO and
            std::abs(v[1]) < VECTOR_PEQUENYO and
@@ -93,11 +65,11 @@ namespace {
     return distancia >= EPSILON_INTERSECCION and distancia < t_actual;
   }
 
-  bool intersectar_esfera(Ray const & rayo, Sphere const & esfera, HitRecord & hit) {
+  bool intersectar_esfera(Ray const & rayo, RenderSphere const & esfera, HitRecord & hit) {
     auto const rc              = sub(esfera.center, rayo.origin);
     double const a             = dot(rayo.direction, rayo.direction);
     double const b             = -COEF_CUADRATICA * dot(rayo.direction, rc);
-    double const c             = dot(rc, rc) - esfera.radius * esfera.radius;
+    double const c             = dot(rc, rc) - esfera.radius2;
     double const discriminante = b * b - COEF_CUADRATICA_INV * a * c;
     if (discriminante < COLOR_NEGRO) {
       return false;
@@ -130,31 +102,13 @@ namespace {
     return true;
   }
 
-  struct DatosCilindro {
-    std::array<double, 3> centro;
-    std::array<double, 3> eje;
-    double altura;
-    double radio;
-    std::uint32_t mat_id;
-  };
-
-  [[nodiscard]] DatosCilindro preparar_cilindro(Cylinder const & cilindro) {
-    DatosCilindro datos{};
-    datos.altura = length(cilindro.axis);
-    datos.eje    = normalize(cilindro.axis);
-    datos.centro = cilindro.base_center;
-    datos.radio  = cilindro.radius;
-    datos.mat_id = cilindro.material_id;
-    return datos;
-  }
-
-  bool probar_superficie_curva(Ray const & rayo, DatosCilindro const & datos, HitRecord & hit) {
-    auto const rc     = sub(rayo.origin, datos.centro);
-    auto const op     = perp_to_axis(rc, datos.eje);
-    auto const dp     = perp_to_axis(rayo.direction, datos.eje);
+  bool probar_superficie_curva(Ray const & rayo, RenderCylinder const & cil, HitRecord & hit) {
+    auto const rc     = sub(rayo.origin, cil.center);
+    auto const op     = perp_to_axis(rc, cil.axis);
+    auto const dp     = perp_to_axis(rayo.direction, cil.axis);
     double const a    = dot(dp, dp);
     double const b    = COEF_CUADRATICA * dot(op, dp);
-    double const c    = dot(op, op) - datos.radio * datos.radio;
+    double const c    = dot(op, op) - cil.radius2;
     double const disc = b * b - COEF_CUADRATICA_INV * a * c;
     if (disc < COLOR_NEGRO or std::abs(a) <= EPSILON_DENOMINADOR) {
       return false;
@@ -163,84 +117,147 @@ namespace {
     if (not validar_distancia(dist, hit.t)) {
       return false;
     }
-    auto const punto          = add(rayo.origin, mul(rayo.direction, dist));
-    auto const ic             = sub(punto, datos.centro);
-    double const proy         = dot(ic, datos.eje);
-    double const mitad_altura = datos.altura / COEF_CUADRATICA;
-    if (proy < -mitad_altura or proy > mitad_altura) {
+    auto const punto  = add(rayo.origin, mul(rayo.direction, dist));
+    auto const ic     = sub(punto, cil.center);
+    double const proy = dot(ic, cil.axis);
+    if (proy < -cil.half_height or proy > cil.half_height) {
       return false;
     }
 
     hit.hit    = true;
     hit.t      = dist;
     hit.point  = punto;
-    hit.normal = normalize(perp_to_axis(ic, datos.eje));
+    hit.normal = normalize(perp_to_axis(ic, cil.axis));
     if (dot(rayo.direction, hit.normal) > 0.0) {
       hit.normal = mul(hit.normal, -1.0);
     }
-    hit.material_id = datos.mat_id;
+    hit.material_id = cil.material_id;
     return true;
   }
 
-  struct DatosTapa {
-    std::array<double, 3> centro;
-    std::array<double, 3> normal;
-    double radio;
-    std::uint32_t mat_id;
-  };
-
-  bool probar_tapa(Ray const & rayo, DatosTapa const & tapa, HitRecord & hit) {
-    double const denom = dot(rayo.direction, tapa.normal);
+  bool probar_tapa(Ray const & rayo, std::array<double, 3> const & centro,
+                   std::array<double, 3> const & normal, RenderCylinder const & cil,
+                   HitRecord & hit) {
+    double const denom = dot(rayo.direction, normal);
     if (std::abs(denom) <= EPSILON_DENOMINADOR) {
       return false;
     }
 
-    auto const pr     = sub(tapa.centro, rayo.origin);
-    double const dist = dot(pr, tapa.normal) / denom;
+    auto const pr     = sub(centro, rayo.origin);
+    double const dist = dot(pr, normal) / denom;
     if (not validar_distancia(dist, hit.t)) {
       return false;
     }
 
     auto const punto = add(rayo.origin, mul(rayo.direction, dist));
-    auto const dr    = sub(punto, tapa.centro);
-    if (length(dr) > tapa.radio) {
+    auto const dr    = sub(punto, centro);
+    if (length(dr) > cil.radius) {
       return false;
     }
 
     hit.hit    = true;
     hit.t      = dist;
     hit.point  = punto;
-    hit.normal = tapa.normal;
+    hit.normal = normal;
     if (dot(rayo.direction, hit.normal) > 0.0) {
       hit.normal = mul(hit.normal, -1.0);
     }
-    hit.material_id = tapa.mat_id;
+    hit.material_id = cil.material_id;
     return true;
   }
 
-  bool intersectar_cilindro(Ray const & rayo, Cylinder const & cilindro, HitRecord & hit) {
-    auto const datos = preparar_cilindro(cilindro);
-    probar_superficie_curva(rayo, datos, hit);
-
-    auto const mitad_eje = mul(cilindro.axis, COLOR_BLANCO / COEF_CUADRATICA);
-    auto const base_inf  = sub(datos.centro, mitad_eje);
-    auto const base_sup  = add(datos.centro, mitad_eje);
+  // devuelve true solo si este cilindro ha mejorado el impacto
+  bool intersectar_cilindro(Ray const & rayo, RenderCylinder const & cil, HitRecord & hit) {
+    bool acierto = probar_superficie_curva(rayo, cil, hit);
+    acierto      = probar_tapa(rayo, cil.cap_lo, cil.normal_lo, cil, hit) or acierto;
+    acierto      = probar_tapa(rayo, cil.cap_hi, cil.axis, cil, hit) or acierto;
+    return acierto;
+  }
 
-    DatosTapa const tapa_inf{base_inf, mul(datos.eje, NEGATIVO), datos.radio, datos.mat_id};
-    probar_tapa(rayo, tapa_inf, hit);
+  // test de slab; los NaN (0 * inf) se descartan en min/max, lo que deja la caja abierta
+  [[nodiscard]] inline bool intersectar_caja(Ray const & rayo, std::array<double, 3> const & inv,
+                                             BvhNode const & nodo, double t_max) {
+    double t_entrada = 0.0;
+    double t_salida  = t_max;
+    for (std::size_t i = 0; i < 3; ++i) {
+      double t0 = (nodo.lo.at(i) - rayo.origin.at(i)) * inv.at(i);
+      double t1 = (nodo.hi.at(i) - rayo.origin.at(i)) * inv.at(i);
+      if (t0 > t1) {
+        std::swap(t0, t1);
+      }
+      t_entrada = std::max(t_entrada, t0);
+      t_salida  = std::min(t_salida, t1);
+    }
+    return t_entrada <= t_salida;
+  }
 
-    DatosTapa const tapa_sup{base_sup, datos.eje, datos.radio, datos.mat_id};
-    probar_tapa(rayo, tapa_sup, hit);
+  [[nodiscard]] SphereView vista_esferas(SphereSoA const & s) {
+    return {s.cx.data(), s.cy.data(), s.cz.data(), s.r2.data(), s.id.data()};
+  }
 
-    return hit.hit;
+  [[nodiscard]] CylinderView vista_cilindros(CylinderSoA const & c) {
+    return {c.cx.data(),  c.cy.data(),  c.cz.data(),          c.ax.data(),     c.ay.data(),
+            c.az.data(),  c.lox.data(), c.loy.data(),         c.loz.data(),    c.hix.data(),
+            c.hiy.data(), c.hiz.data(), c.half_height.data(), c.radius.data(), c.r2.data(),
+            c.id.data()};
   }
 
-  void buscar_intersecciones(Ray const & rayo, Scene const & escena, HitRecord & hit) {
-    for (auto const & esfera : escena.spheres) {
-      intersectar_esfera(rayo, esfera, hit);
+  // Recorrido del BVH de delante hacia atras: se apila primero el hijo lejano. Las hojas
+  // se prueban por bloques con los kernels SIMD, que solo eligen la primitiva mas cercana
+  // (a igual distancia gana el id menor, como en el bucle lineal de esferas y luego
+  // cilindros); el HitRecord se rellena al final con el codigo escalar.
+  void buscar_intersecciones(Ray const & rayo, RenderScene const & escena,
+                             IntersectKernels const & kernels, HitRecord & hit) {
+    BvhView const & bvh = escena.bvh;
+    if (bvh.nodes.empty()) {
+      return;
     }
-    for (auto const & cilindro : escena.cylinders) {
-      intersectar_cilindro(rayo, cilindro, hit);
+    SphereView const esferas     = vista_esferas(escena.spheres);
+    CylinderView const cilindros = vista_cilindros(escena.cylinders);
+    SimdRay const rs{rayo.origin[0],    rayo.origin[1],    rayo.origin[2],
+                     rayo.direction[0], rayo.direction[1], rayo.direction[2]};
+    std::array<double, 3> const inv{1.0 / rayo.direction[0], 1.0 / rayo.direction[1],
+                                    1.0 / rayo.direction[2]};
+
+    HitCandidate mejor{hit.t, std::numeric_limits<std::uint32_t>::max(),
+                       std::numeric_limits<std::uint32_t>::max()};
+    std::array<std::uint32_t, TAM_PILA_BVH> pila{};
+    std::size_t tope = 0;
+    pila.at(tope++)  = 0;
+
+    while (tope > 0) {
+      std::uint32_t const indice = pila.at(--tope);
+      BvhNode const & nodo       = bvh.nodes[indice];
+      if (not intersectar_caja(rayo, inv, nodo, mejor.t)) {
+        continue;
+      }
+      if (nodo.is_leaf()) {
+        if (nodo.count > 0) {
+          kernels.spheres(rs, esferas, nodo.offset, nodo.count, mejor);
+        }
+        if (nodo.cyl_count > 0) {
+          kernels.cylinders(rs, cilindros, nodo.cyl_offset, nodo.cyl_count, mejor);
+        }
+        continue;
+      }
+      std::uint32_t const primero = indice + 1;
+      std::uint32_t const segundo = nodo.offset;
+      if (inv.at(nodo.axis) < 0.0) {
+        pila.at(tope++) = primero;
+        pila.at(tope++) = segundo;
+      } else {
+        pila.at(tope++) = segundo;
+        pila.at(tope++) = primero;
+      }
+    }
+
+    if (mejor.slot == std::numeric_limits<std::uint32_t>::max()) {
+      return;
+    }
+    if (mejor.id < bvh.num_spheres) {
+      intersectar_esfera(rayo, escena.spheres.get(mejor.slot), hit);
+    } else {
+      intersectar_cilindro(rayo, escena.cylinders.get(mejor.slot), hit);
     }
   }
 
@@ -253,7 +270,7 @@ namespace {
 
   struct RayContext {
     std::size_t depth;
-    std::mt19937_64 * material_rng;
+    Sampler material_rng;  // clave (semilla de material, flujo material, pixel, muestra)
   };
 
   struct ReflectionResult {
@@ -262,30 +279,30 @@ namespace {
   };
 
   [[nodiscard]] ReflectionResult calcular_reflexion_mate(std::array<double, 3> const & normal,
-                                                         Material const & mat,
-                                                         std::mt19937_64 * rng) {
-    std::uniform_real_distribution<double> dist(-1.0, 1.0);
-    std::array<double, 3> dr{normal[0] + dist(*rng), normal[1] + dist(*rng),
-                             normal[2] + dist(*rng)};
+                                                         RenderMaterial const & mat,
+                                                         Sampler & rng) {
+    std::array<double, 3> dr{normal[0] + rng.uniform(-1.0, 1.0),
+                             normal[1] + rng.uniform(-1.0, 1.0),
+                             normal[2] + rng.uniform(-1.0, 1.0)};
     if (vector_demasiado_pequenyo(dr)) {
       dr = normal;
     }
-    return {normalize(dr), mat.matte.rgb};
+    return {normalize(dr), mat.rgb};
   }
 
   [[nodiscard]] ReflectionResult calcular_reflexion_metal(std::array<double, 3> const & d_hat,
                                                           std::array<double, 3> const & normal,
-                                                          Material const & mat,
-                                                          std::mt19937_64 * rng) {
+                                                          RenderMaterial const & mat,
+                                                          Sampler & rng) {
     auto const d1     = sub(d_hat, mul(normal, 2.0 * dot(d_hat, normal)));
     auto const d1_hat = normalize(d1);
 
-    std::uniform_real_distribution<double> dist(-mat.metal.diffusion, mat.metal.diffusion);
-    std::array<double, 3> const ruido{dist(*rng), dist(*rng), dist(*rng)};
+    double const k = mat.diffusion();
+    std::array<double, 3> const ruido{rng.uniform(-k, k), rng.uniform(-k, k), rng.uniform(-k, k)};
 
     auto const dr_final = add(d1_hat, ruido);
 
-    return {dr_final, mat.metal.rgb};
+    return {dr_final, mat.rgb};
   }
 
   // FIXED: Corrected refractive index calculation per specification section 3.5.3
@@ -293,13 +310,13 @@ namespace {
   // If inward: ρ' = η
   [[nodiscard]] ReflectionResult calcular_reflexion_refractiva(std::array<double, 3> const & d_hat,
                                                                std::array<double, 3> normal,
-                                                               Material const & mat) {
+                                                               RenderMaterial const & mat) {
     bool const hacia_fuera = dot(d_hat, normal) < 0.0;
     double const cos_theta = std::min(-dot(d_hat, normal), 1.0);
     double const sin_theta = std::sqrt(std::max(0.0, 1.0 - cos_theta * cos_theta));
 
     // CORRECTED: outward = 1/η, inward = η
-    double const rho_p = hacia_fuera ? (1.0 / mat.refr.index) : mat.refr.index;
+    double const rho_p = hacia_fuera ? (1.0 / mat.index()) : mat.index();
 
     if (not hacia_fuera) {
       normal = mul(normal, -1.0);
@@ -318,13 +335,12 @@ namespace {
     };
   }
 
-  [[nodiscard]] std::array<double, 3> ray_color(Ray const & rayo, Scene const * escena,
-                                                Camera const * cam, RayContext & ctx);
-
+  // El tipo viene de la referencia del material (material_ref), no de la tabla.
   [[nodiscard]] ReflectionResult calcular_reflexion(std::array<double, 3> const & d_hat,
                                                     std::array<double, 3> const & normal,
-                                                    Material const & mat, std::mt19937_64 * rng) {
-    switch (mat.type) {
+                                                    std::uint32_t ref, RenderMaterial const & mat,
+                                                    Sampler & rng) {
+    switch (material_type(ref)) {
       case MaterialType::Matte:      return calcular_reflexion_mate(normal, mat, rng);
       case MaterialType::Metal:      return calcular_reflexion_metal(d_hat, normal, mat, rng);
       case MaterialType::Refractive: return calcular_reflexion_refractiva(d_hat, normal, mat);
@@ -336,95 +352,656 @@ namespace {
     }
   }
 
-  [[nodiscard]] std::array<double, 3> ray_color(Ray const & rayo, Scene const * escena,
+  [[nodiscard]] inline double maximo_componente(std::array<double, 3> const & c) {
+    return std::max({c[0], c[1], c[2]});
+  }
+
+  // Ruleta rusa: sobrevive con probabilidad p = max(throughput) y compensa dividiendo
+  // por p, asi que el estimador sigue sin sesgo.
+  [[nodiscard]] bool sobrevive_ruleta(std::array<double, 3> & throughput, Sampler & rng) {
+    double const p = std::min(maximo_componente(throughput), COLOR_BLANCO);
+    if (rng.next_double() >= p) {
+      return false;
+    }
+    throughput = mul(throughput, COLOR_BLANCO / p);
+    return true;
+  }
+
+  // Camino iterativo: el throughput acumula el producto de reflectancias de los rebotes
+  // ya hechos, de modo que el camino puede cortarse en cuanto deja de aportar.
+  [[nodiscard]] std::array<double, 3> ray_color(Ray rayo, RenderScene const * escena,
                                                 Camera const * cam, RayContext & ctx) {
-    if (ctx.depth == 0U) {
-      return {0.0, 0.0, 0.0};
+    std::array<double, 3> throughput{COLOR_BLANCO, COLOR_BLANCO, COLOR_BLANCO};
+    for (std::size_t rebote = 0; rebote < ctx.depth; ++rebote) {
+      ctx.material_rng.set_bounce(static_cast<std::uint32_t>(rebote));
+      HitRecord hit{};
+      hit.t   = std::numeric_limits<double>::infinity();
+      hit.hit = false;
+      buscar_intersecciones(rayo, *escena, intersect_kernels(), hit);
+
+      if (not hit.hit) {
+        auto const fondo = calcular_color_fondo(rayo.direction, *cam);
+        return {throughput[0] * fondo[0], throughput[1] * fondo[1], throughput[2] * fondo[2]};
+      }
+
+      std::uint32_t const ref = hit.material_id;
+      auto const & mat        = escena->materials[material_index(ref)];
+      auto const d_hat        = normalize(rayo.direction);
+      auto const refl         = calcular_reflexion(d_hat, hit.normal, ref, mat, ctx.material_rng);
+      throughput              = {throughput[0] * refl.reflectancia[0],
+                                 throughput[1] * refl.reflectancia[1],
+                                 throughput[2] * refl.reflectancia[2]};
+
+      if (maximo_componente(throughput) <= cam->throughput_threshold) {
+        break;
+      }
+      if (cam->russian_roulette_depth > 0 and
+          rebote + 1 >= std::size_t(cam->russian_roulette_depth) and
+          not sobrevive_ruleta(throughput, ctx.material_rng)) {
+        break;
+      }
+
+      rayo.origin    = hit.point;
+      rayo.direction = refl.direction;
+    }
+    return {COLOR_NEGRO, COLOR_NEGRO, COLOR_NEGRO};
+  }
+
+  // Una muestra del pixel (fila, col). Los numeros aleatorios quedan fijados por (semilla,
+  // flujo, pixel, muestra), asi que no dependen del hilo ni del orden en que se tomen; el
+  // flujo separa los del rayo de los del material aunque las semillas coincidan.
+  [[nodiscard]] std::array<double, 3> muestrear(Camera const & camara, RenderScene const & escena,
+                                                std::size_t fila, std::size_t col,
+                                                std::size_t idx, std::size_t s) {
+    auto const n = std::uint32_t(camara.samples_per_pixel);
+    Sampler rng_rayo(camara.sampler, camara.ray_rng_seed, RngStream::ray, idx, std::uint32_t(s),
+                     n);
+    auto const pos = calcular_pos_pixel(camara, double(col) + rng_rayo.uniform(-0.5, 0.5),
+                                        double(fila) + rng_rayo.uniform(-0.5, 0.5));
+    Ray const rayo{camara.P, normalize(sub(pos, camara.P))};
+    RayContext ctx{std::size_t(camara.max_depth),
+                   Sampler(camara.sampler, camara.material_rng_seed, RngStream::material, idx,
+                           std::uint32_t(s), n)};
+    return ray_color(rayo, &escena, &camara, ctx);
+  }
+
+  // Donde acaban los pixeles terminados: los planos de un FramebufferSOA o un buffer RGB
+  // entrelazado de 3 bytes por pixel (p. ej. los pixeles de un P6 proyectado en memoria).
+  // Un destino puede cubrir solo una parte de la imagen: origen es el indice de su primer
+  // pixel. El color lineal pasa a bytes con la tabla de tono (gamma) del render y, si el
+  // framebuffer tiene planos float, se guarda tambien tal cual.
+  struct Destino {
+    FramebufferSOA * planos = nullptr;
+    std::uint8_t * rgb      = nullptr;
+    std::size_t origen      = 0;
+    ToneMapper const * tono = nullptr;
+    std::size_t ancho       = 0;  // de la imagen, para el paso de los planos float
+  };
+
+  void escribir_pixel(Destino const & destino, std::size_t idx,
+                      std::array<double, 3> const & color) {
+    auto const & tono = *destino.tono;
+    Pixel const px{tono(color[0]), tono(color[1]), tono(color[2])};
+    idx -= destino.origen;
+    if (destino.rgb != nullptr) {
+      // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+      destino.rgb[3 * idx]     = px.r;
+      destino.rgb[3 * idx + 1] = px.g;
+      destino.rgb[3 * idx + 2] = px.b;
+      // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+      return;
+    }
+    auto & planos = *destino.planos;
+    planos.R[idx] = px.r;
+    planos.G[idx] = px.g;
+    planos.B[idx] = px.b;
+    if (not planos.linealR.empty()) {
+      auto const i      = idx / destino.ancho * planos.pasoLineal + idx % destino.ancho;
+      planos.linealR[i] = float(color[0]);
+      planos.linealG[i] = float(color[1]);
+      planos.linealB[i] = float(color[2]);
     }
+  }
 
-    HitRecord hit{};
-    hit.t   = std::numeric_limits<double>::infinity();
-    hit.hit = false;
-    buscar_intersecciones(rayo, *escena, hit);
+  // ---------- Planificador de teselas ----------
+
+  using Reloj = std::chrono::steady_clock;
+
+  // Teselas en el orden de la curva elegida, el orden en que se reparten y el tiempo
+  // gastado en cada una.
+  struct Planificador {
+    std::vector<Tile> teselas;
+    std::vector<std::uint32_t> orden;
+    std::vector<double> ultima;  // tiempo de la ultima pasada
+    std::vector<double> costes;  // tiempo acumulado del render, para el informe
+    bool por_coste;
+
+    explicit Planificador(Camera const & camara)
+        : teselas(make_tiles(camara.image_width, camara.image_height, camara.tile_size,
+                             camara.tile_order)),
+          orden(teselas.size()), ultima(teselas.size(), 0.0), costes(teselas.size(), 0.0),
+          por_coste(camara.tile_costs.size() == teselas.size()) {
+      for (std::size_t i = 0; i < orden.size(); ++i) {
+        orden[i] = std::uint32_t(i);
+      }
+      // sin costes medidos de estas teselas se reparte en orden de curva
+      if (por_coste) {
+        ultima = camara.tile_costs;
+        priorizar();
+        std::ranges::fill(ultima, 0.0);
+      }
+    }
 
-    if (not hit.hit) {
-      return calcular_color_fondo(rayo.direction, *cam);
+    // Cada hilo toma la siguiente tesela libre. En orden de curva, las que se ejecutan a
+    // la vez son vecinas y comparten en cache los datos de escena que tocan; en orden de
+    // coste, las caras salen primero y las baratas rellenan el final.
+    template <typename Trabajo>
+    void recorrer(Trabajo const & trabajo) {
+      std::atomic<std::size_t> siguiente{0};
+      tbb::parallel_for(0, tbb::this_task_arena::max_concurrency(), [&](int) {
+        for (auto i = siguiente++; i < orden.size(); i = siguiente++) {
+          auto const t      = orden[i];
+          auto const inicio = Reloj::now();
+          trabajo(teselas[t]);
+          ultima[t] = std::chrono::duration<double>(Reloj::now() - inicio).count();
+        }
+      });
     }
 
-    auto const & mat = escena->materials[hit.material_id];
-    auto const d_hat = normalize(rayo.direction);
-    auto const refl  = calcular_reflexion(d_hat, hit.normal, mat, ctx.material_rng);
+    // Suma la ultima pasada al informe.
+    void anotar() {
+      for (std::size_t i = 0; i < costes.size(); ++i) {
+        costes[i] += ultima[i];
+      }
+    }
 
-    Ray siguiente{};
-    siguiente.origin    = hit.point;
-    siguiente.direction = refl.direction;
+    // Con costes medidos, la siguiente pasada reparte primero las teselas que mas
+    // tardaron en la ultima; a igual tiempo se conserva el orden de la curva.
+    void priorizar() {
+      if (not por_coste) {
+        return;
+      }
+      std::stable_sort(orden.begin(), orden.end(),
+                       [&](std::uint32_t a, std::uint32_t b) { return ultima[a] > ultima[b]; });
+    }
+
+    [[nodiscard]] std::vector<TileCost> informe() const {
+      std::vector<TileCost> salida;
+      salida.reserve(teselas.size());
+      for (std::size_t i = 0; i < teselas.size(); ++i) {
+        salida.push_back({teselas[i], costes[i]});
+      }
+      return salida;
+    }
+  };
 
-    ctx.depth -= 1U;
-    auto const c_sig = ray_color(siguiente, escena, cam, ctx);
-    ctx.depth += 1U;
+  // ---------- Paralelismo por muestras ----------
 
-    return {c_sig[0] * refl.reflectancia[0], c_sig[1] * refl.reflectancia[1],
-            c_sig[2] * refl.reflectancia[2]};
+  constexpr std::size_t TRABAJOS_OBJETIVO  = 1'024;
+  constexpr std::size_t MUESTRAS_MIN_TROZO = 16;
+
+  // Con pocas teselas y muchas muestras (miniaturas a miles de spp) no hay trabajo para
+  // todos los nucleos: las muestras de cada pixel se parten en trozos hasta tener unos
+  // TRABAJOS_OBJETIVO trabajos. Solo depende de la imagen y de spp, no del numero de
+  // hilos, asi que la imagen sale igual en cualquier maquina.
+  [[nodiscard]] std::size_t trozos_por_pixel(std::size_t teselas, std::size_t spp) {
+    auto const por_trabajos = (TRABAJOS_OBJETIVO + teselas - 1) / std::max(teselas, std::size_t{1});
+    return std::clamp(por_trabajos, std::size_t{1},
+                      std::max(spp / MUESTRAS_MIN_TROZO, std::size_t{1}));
   }
 
-  [[nodiscard]] inline Pixel color_a_pixel(std::array<double, 3> const & c, double gamma) {
-    auto corregir = [gamma](double v) {
-      v = std::clamp(v, 0.0, 1.0);
-      if (gamma > 0.0) {
-        v = std::pow(v, 1.0 / gamma);
+  // Traza las samples_per_pixel muestras de cada pixel de la tesela. Con varios trozos,
+  // cada uno suma su rango de muestras en paralelo y las sumas parciales se reducen
+  // despues en orden de trozo, de modo que el resultado no depende de que hilo hizo cada
+  // trozo. Con un solo trozo la suma es la secuencial de siempre.
+  void trazar_tesela(Camera const & camara, RenderScene const & escena, Tile const & t,
+                     std::size_t trozos, Destino const & destino) {
+    auto const ancho   = std::size_t(camara.image_width);
+    auto const spp     = std::size_t(camara.samples_per_pixel);
+    auto const ancho_t = std::size_t(t.x1 - t.x0);
+    auto const npix    = ancho_t * std::size_t(t.y1 - t.y0);
+    std::vector<std::array<double, 3>> parciales(trozos * npix, {0.0, 0.0, 0.0});
+
+    auto const sumar_trozo = [&](std::size_t k) {
+      auto const desde = spp * k / trozos, hasta = spp * (k + 1) / trozos;
+      for (std::size_t p = 0; p < npix; ++p) {
+        auto const fila = t.y0 + p / ancho_t, col = t.x0 + p % ancho_t;
+        auto & acc      = parciales[k * npix + p];
+        for (std::size_t s = desde; s < hasta; ++s) {
+          auto const c  = muestrear(camara, escena, fila, col, fila * ancho + col, s);
+          acc[0]       += c[0];
+          acc[1]       += c[1];
+          acc[2]       += c[2];
+        }
       }
-      return v;
     };
-    return {color_a_byte(corregir(c[0])), color_a_byte(corregir(c[1])),
-            color_a_byte(corregir(c[2]))};
+    if (trozos == 1) {
+      sumar_trozo(0);
+    } else {
+      tbb::parallel_for(std::size_t{0}, trozos, sumar_trozo);
+    }
+
+    double const inv = 1.0 / double(spp);
+    for (std::size_t p = 0; p < npix; ++p) {
+      auto acc = parciales[p];
+      for (std::size_t k = 1; k < trozos; ++k) {
+        acc[0] += parciales[k * npix + p][0];
+        acc[1] += parciales[k * npix + p][1];
+        acc[2] += parciales[k * npix + p][2];
+      }
+      acc[0] *= inv;
+      acc[1] *= inv;
+      acc[2] *= inv;
+      auto const fila = t.y0 + p / ancho_t, col = t.x0 + p % ancho_t;
+      escribir_pixel(destino, fila * ancho + col, acc);
+    }
   }
 
-  struct RNGBundle {
-    std::mt19937_64 gm, gr;
-    std::uniform_real_distribution<double> d;
+  // ---------- Muestreo adaptativo ----------
+
+  constexpr double Z_95              = 1.96;  // intervalo de confianza del 95%
+  constexpr double LUMINANCIA_MINIMA = 0.05;  // suelo del error relativo en zonas oscuras
+
+  // Suma de color y media/varianza de la luminancia por Welford.
+  struct EstadoPixel {
+    std::array<double, 3> suma{};
+    double media{};
+    double m2{};
+    std::uint32_t n{};
+
+    void anyadir(std::array<double, 3> const & c) {
+      suma[0] += c[0];
+      suma[1] += c[1];
+      suma[2] += c[2];
+      double const y     = 0.2126 * c[0] + 0.7152 * c[1] + 0.0722 * c[2];
+      ++n;
+      double const delta  = y - media;
+      media              += delta / double(n);
+      m2                 += delta * (y - media);
+    }
 
-    RNGBundle(std::uint64_t sm, std::uint64_t sr) : gm(sm), gr(sr), d(-0.5, 0.5) { }
+    // Semiancho del intervalo de confianza relativo al brillo del pixel.
+    [[nodiscard]] double error_relativo() const {
+      if (n < 2) {
+        return std::numeric_limits<double>::infinity();
+      }
+      double const varianza = m2 / double(n - 1);
+      return Z_95 * std::sqrt(varianza / double(n)) / std::max(media, LUMINANCIA_MINIMA);
+    }
   };
 
-}  // namespace
+  void muestrear_rango(Camera const & camara, RenderScene const & escena, std::size_t idx,
+                       std::size_t muestras, EstadoPixel & estado) {
+    auto const ancho = std::size_t(camara.image_width);
+    auto const desde = std::size_t(estado.n);
+    for (std::size_t s = desde; s < desde + muestras; ++s) {
+      estado.anyadir(muestrear(camara, escena, idx / ancho, idx % ancho, idx, s));
+    }
+  }
 
-void trace_rays_soa(Camera const & camara, Scene const & escena, FramebufferSOA & framebuffer) {
-  auto const ancho = std::size_t(camara.image_width), alto = std::size_t(camara.image_height);
-  framebuffer.R.resize(ancho * alto);
-  framebuffer.G.resize(ancho * alto);
-  framebuffer.B.resize(ancho * alto);
-  auto const spp = std::size_t(camara.samples_per_pixel), max_depth = std::size_t(camara.max_depth);
-  tbb::enumerable_thread_specific<RNGBundle> ets_rng(
-      RNGBundle{std::mt19937_64::result_type(camara.material_rng_seed),
-                std::mt19937_64::result_type(camara.ray_rng_seed)});
-  tbb::parallel_for(
-      tbb::blocked_range2d<std::size_t>(0, alto, 0, ancho),
-      [&](tbb::blocked_range2d<std::size_t> const & r) {
-        auto & rng = ets_rng.local();
-        for (auto fila = r.rows().begin(); fila != r.rows().end(); ++fila) {
-          for (auto col = r.cols().begin(); col != r.cols().end(); ++col) {
-            std::array<double, 3> acc{0.0, 0.0, 0.0};
-            for (std::size_t s = 0; s < spp; ++s) {
-              auto const pos = calcular_pos_pixel(camara, double(col) + rng.d(rng.gr),
-                                                  double(fila) + rng.d(rng.gr));
-              Ray const rayo{camara.P, normalize(sub(pos, camara.P))};
-              RayContext ctx{max_depth, &rng.gm};
-              auto const c = ray_color(rayo, &escena, &camara, ctx);
-              acc[0] += c[0];
-              acc[1] += c[1];
-              acc[2] += c[2];
+  // Todos los pixeles toman adaptive_min_samples; despues, por rondas, los que aun no
+  // convergen reciben otro lote mientras quede presupuesto (samples_per_pixel de media).
+  // Cada ronda reparte el presupuesto restante entre los pixeles activos, y si no llega
+  // para todos se lo quedan los mas ruidosos.
+  std::uint64_t trazar_adaptativo(Camera const & camara, RenderScene const & escena,
+                                  Destino const & destino) {
+    auto const ancho = std::size_t(camara.image_width), alto = std::size_t(camara.image_height);
+    auto const total  = ancho * alto;
+    auto const maximo = std::size_t(camara.adaptive_max_samples);
+    auto const lote   = std::min(std::size_t(camara.adaptive_min_samples),
+                                 std::size_t(camara.samples_per_pixel));
+    std::size_t presupuesto = total * std::size_t(camara.samples_per_pixel);
+    std::vector<EstadoPixel> estados(total);
+
+    tbb::parallel_for(
+        tbb::blocked_range<std::size_t>(0, total),
+        [&](tbb::blocked_range<std::size_t> const & r) {
+          for (auto idx = r.begin(); idx != r.end(); ++idx) {
+            muestrear_rango(camara, escena, idx, lote, estados[idx]);
+          }
+        },
+        tbb::auto_partitioner{});
+    presupuesto -= total * lote;
+
+    std::vector<std::uint32_t> activos;
+    std::vector<double> errores(total);
+    while (presupuesto > 0) {
+      activos.clear();
+      for (std::size_t idx = 0; idx < total; ++idx) {
+        errores[idx] = estados[idx].error_relativo();
+        if (estados[idx].n < maximo and errores[idx] > camara.adaptive_error) {
+          activos.push_back(std::uint32_t(idx));
+        }
+      }
+      if (activos.empty()) {
+        break;
+      }
+      if (activos.size() > presupuesto) {
+        auto const corte = activos.begin() + std::ptrdiff_t(presupuesto);
+        std::nth_element(activos.begin(), corte, activos.end(),
+                         [&](std::uint32_t a, std::uint32_t b) {
+                           return errores[a] > errores[b] or (errores[a] == errores[b] and a < b);
+                         });
+        activos.erase(corte, activos.end());
+      }
+
+      auto const lote_ronda = std::clamp(presupuesto / activos.size(), std::size_t{1}, lote);
+      for (auto const idx : activos) {
+        presupuesto -= std::min(lote_ronda, maximo - estados[idx].n);
+      }
+      tbb::parallel_for(
+          tbb::blocked_range<std::size_t>(0, activos.size()),
+          [&](tbb::blocked_range<std::size_t> const & r) {
+            for (auto i = r.begin(); i != r.end(); ++i) {
+              auto & estado = estados[activos[i]];
+              muestrear_rango(camara, escena, activos[i],
+                              std::min(lote_ronda, maximo - estado.n), estado);
+            }
+          },
+          tbb::auto_partitioner{});
+    }
+
+    std::uint64_t muestras = 0;
+    for (std::size_t idx = 0; idx < total; ++idx) {
+      auto const & estado = estados[idx];
+      double const inv    = 1.0 / double(estado.n);
+      escribir_pixel(destino, idx,
+                     {estado.suma[0] * inv, estado.suma[1] * inv, estado.suma[2] * inv});
+      muestras += estado.n;
+    }
+    return muestras;
+  }
+
+  // ---------- Render progresivo ----------
+
+  // Muestras que lleva cada pixel (una pasada cortada por la fecha limite deja algunos con
+  // una mas), con el mismo paso de fila que los planos float del framebuffer.
+  struct BufferAcumulacion {
+    std::vector<std::uint32_t, PlanoAllocator<std::uint32_t>> n;
+
+    // Sumas y cuentas se ponen a cero en paralelo: el primer contacto reparte sus paginas
+    // entre los nodos NUMA de los hilos del render en vez de dejarlas todas en el nodo
+    // del hilo principal.
+    BufferAcumulacion(FramebufferSOA & framebuffer, int ancho, int alto) {
+      initLinealSOA(framebuffer, ancho, alto);
+      n.resize(framebuffer.linealR.size());
+      tbb::parallel_for(
+          tbb::blocked_range<std::size_t>(0, n.size()),
+          [&](tbb::blocked_range<std::size_t> const & r) {
+            for (auto i = r.begin(); i != r.end(); ++i) {
+              framebuffer.linealR[i] = 0.0F;
+              framebuffer.linealG[i] = 0.0F;
+              framebuffer.linealB[i] = 0.0F;
+              n[i]                   = 0;
+            }
+          },
+          tbb::static_partitioner{});
+    }
+
+    [[nodiscard]] std::uint64_t muestras() const {
+      std::uint64_t suma = 0;
+      for (auto const m : n) {
+        suma += m;
+      }
+      return suma;
+    }
+
+    // Al acabar el render, cambia las sumas de los planos float por la media de cada pixel.
+    void dividir(FramebufferSOA & framebuffer) const {
+      tbb::parallel_for(
+          tbb::blocked_range<std::size_t>(0, n.size()),
+          [&](tbb::blocked_range<std::size_t> const & r) {
+            for (auto i = r.begin(); i != r.end(); ++i) {
+              if (n[i] > 0) {
+                framebuffer.linealR[i] /= float(n[i]);
+                framebuffer.linealG[i] /= float(n[i]);
+                framebuffer.linealB[i] /= float(n[i]);
+              }
             }
-            double const inv = 1.0 / double(spp);
-            acc[0] *= inv;
-            acc[1] *= inv;
-            acc[2] *= inv;
-            auto const px      = color_a_pixel(acc, camara.gamma);
-            auto const idx     = fila * ancho + col;
-            framebuffer.R[idx] = px.r;
-            framebuffer.G[idx] = px.g;
-            framebuffer.B[idx] = px.b;
+          },
+          tbb::static_partitioner{});
+    }
+  };
+
+  // Anyade 'muestras' muestras a cada pixel y reescribe la imagen con la media, pasando
+  // los planos float enteros por la tabla de tono. Las filas que empiecen despues de
+  // fecha_limite se saltan.
+  void trazar_pasada(Camera const & camara, RenderScene const & escena, std::size_t muestras,
+                     Planificador & planificador, BufferAcumulacion & acumulado,
+                     FramebufferSOA & framebuffer, ToneMapper const & tono,
+                     Reloj::time_point fecha_limite) {
+    auto const ancho = std::size_t(camara.image_width);
+    auto const paso  = framebuffer.pasoLineal;
+    planificador.recorrer([&](Tile const & t) {
+      auto const suma_r = vistaTesela(framebuffer.linealR, paso, t);
+      auto const suma_g = vistaTesela(framebuffer.linealG, paso, t);
+      auto const suma_b = vistaTesela(framebuffer.linealB, paso, t);
+      auto const cuenta = vistaTesela(acumulado.n, paso, t);
+      for (std::size_t i = 0; i < cuenta.extent(0); ++i) {
+        if (Reloj::now() >= fecha_limite) {
+          return;
+        }
+        auto const fila = t.y0 + i;
+        for (std::size_t j = 0; j < cuenta.extent(1); ++j) {
+          auto const col   = t.x0 + j;
+          auto const desde = std::size_t(cuenta[i, j]);
+          std::array<double, 3> acc{0.0, 0.0, 0.0};
+          for (std::size_t s = desde; s < desde + muestras; ++s) {
+            auto const c  = muestrear(camara, escena, fila, col, fila * ancho + col, s);
+            acc[0]       += c[0];
+            acc[1]       += c[1];
+            acc[2]       += c[2];
           }
+          suma_r[i, j] += float(acc[0]);
+          suma_g[i, j] += float(acc[1]);
+          suma_b[i, j] += float(acc[2]);
+          cuenta[i, j]  = std::uint32_t(desde + muestras);
         }
-      },
-      tbb::auto_partitioner{});
+      }
+    });
+
+    tbb::parallel_for(
+        tbb::blocked_range<std::size_t>(0, std::size_t(camara.image_height)),
+        [&](tbb::blocked_range<std::size_t> const & r) {
+          for (auto fila = r.begin(); fila != r.end(); ++fila) {
+            auto const * const n = acumulado.n.data() + fila * paso;
+            auto const suma      = fila * paso;
+            auto const px        = fila * ancho;
+            tono.apply(framebuffer.linealR.data() + suma, n, ancho, framebuffer.R.data() + px);
+            tono.apply(framebuffer.linealG.data() + suma, n, ancho, framebuffer.G.data() + px);
+            tono.apply(framebuffer.linealB.data() + suma, n, ancho, framebuffer.B.data() + px);
+          }
+        });
+    planificador.anotar();
+    planificador.priorizar();
+  }
+
+  // Render de samples_per_pixel fijo (o adaptativo) escribiendo en destino.
+  RenderStats trazar_fijo(Camera const & camara, RenderScene const & escena,
+                          Destino const & destino) {
+    auto const ancho = std::size_t(camara.image_width), alto = std::size_t(camara.image_height);
+    if (camara.adaptive_max_samples > 0) {
+      return {trazar_adaptativo(camara, escena, destino), {}};
+    }
+
+    auto const spp = std::size_t(camara.samples_per_pixel);
+    Planificador planificador(camara);
+    auto const trozos = trozos_por_pixel(planificador.teselas.size(), spp);
+    planificador.recorrer(
+        [&](Tile const & t) { trazar_tesela(camara, escena, t, trozos, destino); });
+    planificador.anotar();
+    return {std::uint64_t(ancho * alto * spp), planificador.informe()};
+  }
+
+  // ---------- Render por bandas ----------
+
+  // Una banda terminada: filas completas a partir de fila0.
+  struct Banda {
+    FramebufferSOA pixeles;
+    std::size_t fila0 = 0;
+  };
+
+  // Traza las filas [fila0, fila0 + filas) con las mismas teselas y los mismos trozos que
+  // el render completo, asi que sus pixeles salen identicos.
+  Banda trazar_banda(Camera const & camara, RenderScene const & escena, std::size_t fila0,
+                     std::size_t filas, std::size_t trozos, ToneMapper const & tono) {
+    auto const ancho = std::size_t(camara.image_width);
+    Banda banda{{}, fila0};
+    banda.pixeles.R.resize(ancho * filas);
+    banda.pixeles.G.resize(ancho * filas);
+    banda.pixeles.B.resize(ancho * filas);
+    auto teselas = make_tiles(camara.image_width, int(filas), camara.tile_size,
+                              TileOrder::scanline);
+    for (auto & t : teselas) {
+      t.y0 += std::uint32_t(fila0);
+      t.y1 += std::uint32_t(fila0);
+    }
+    Destino const destino{&banda.pixeles, nullptr, fila0 * ancho, &tono, ancho};
+    tbb::parallel_for(std::size_t{0}, teselas.size(), [&](std::size_t i) {
+      trazar_tesela(camara, escena, teselas[i], trozos, destino);
+    });
+    return banda;
+  }
+
+}  // namespace
+
+RenderStats trace_rays_soa(Camera const & camara, RenderScene const & escena,
+                           FramebufferSOA & framebuffer) {
+  auto const total = std::size_t(camara.image_width) * std::size_t(camara.image_height);
+  framebuffer.R.resize(total);
+  framebuffer.G.resize(total);
+  framebuffer.B.resize(total);
+  ToneMapper const tono(camara.gamma);
+  return trazar_fijo(camara, escena,
+                     {&framebuffer, nullptr, 0, &tono, std::size_t(camara.image_width)});
+}
+
+RenderStats trace_rays_rgb(Camera const & camara, RenderScene const & escena,
+                           std::uint8_t * rgb) {
+  ToneMapper const tono(camara.gamma);
+  return trazar_fijo(camara, escena, {nullptr, rgb, 0, &tono, std::size_t(camara.image_width)});
+}
+
+RenderStats trace_rays_aos(Camera const & camara, RenderScene const & escena,
+                           std::vector<Pixel> & framebuffer) {
+  // Un vector de Pixel es el mismo buffer RGB entrelazado que recibe trace_rays_rgb.
+  static_assert(sizeof(Pixel) == 3 and alignof(Pixel) == 1);
+  framebuffer.resize(std::size_t(camara.image_width) * std::size_t(camara.image_height));
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+  auto * const rgb = reinterpret_cast<std::uint8_t *>(framebuffer.data());
+  return trace_rays_rgb(camara, escena, rgb);
+}
+
+RenderStats trace_rays_progressive(Camera const & camara, RenderScene const & escena,
+                                   FramebufferSOA & framebuffer, PassCallback const & on_pass) {
+  auto const total = std::size_t(camara.image_width) * std::size_t(camara.image_height);
+  framebuffer.R.resize(total);
+  framebuffer.G.resize(total);
+  framebuffer.B.resize(total);
+
+  auto const spp    = std::size_t(camara.samples_per_pixel);
+  auto const pasada = std::max(std::size_t(camara.progressive_samples), std::size_t{1});
+  Planificador planificador(camara);
+  BufferAcumulacion acumulado(framebuffer, camara.image_width, camara.image_height);
+  ToneMapper const tono(camara.gamma);
+  RenderStats stats{0, {}};
+  for (std::size_t hechas = 0; hechas < spp;) {
+    auto const muestras = std::min(pasada, spp - hechas);
+    trazar_pasada(camara, escena, muestras, planificador, acumulado, framebuffer, tono,
+                  Reloj::time_point::max());
+    hechas        += muestras;
+    stats.samples  = std::uint64_t(total * hechas);
+    if (on_pass and not on_pass(framebuffer, stats)) {
+      break;
+    }
+  }
+  acumulado.dividir(framebuffer);
+  stats.tiles = planificador.informe();
+  return stats;
+}
+
+RenderStats trace_rays_until(Camera const & camara, RenderScene const & escena,
+                             FramebufferSOA & framebuffer,
+                             std::chrono::steady_clock::time_point deadline) {
+  auto const total = std::size_t(camara.image_width) * std::size_t(camara.image_height);
+  framebuffer.R.resize(total);
+  framebuffer.G.resize(total);
+  framebuffer.B.resize(total);
+
+  // Pasadas de una muestra sobre todo el cuadro, para que la imagen converja por igual.
+  // La primera se completa siempre: sin ella habria pixeles sin ninguna muestra.
+  Planificador planificador(camara);
+  BufferAcumulacion acumulado(framebuffer, camara.image_width, camara.image_height);
+  ToneMapper const tono(camara.gamma);
+  trazar_pasada(camara, escena, 1, planificador, acumulado, framebuffer, tono,
+                Reloj::time_point::max());
+  while (Reloj::now() < deadline) {
+    trazar_pasada(camara, escena, 1, planificador, acumulado, framebuffer, tono, deadline);
+  }
+  acumulado.dividir(framebuffer);
+  return {acumulado.muestras(), planificador.informe()};
+}
+
+RenderStats trace_rays_streaming(Camera const & camara, RenderScene const & escena,
+                                 int max_bands, BandCallback const & on_band) {
+  auto const ancho = std::size_t(camara.image_width), alto = std::size_t(camara.image_height);
+  auto const spp   = std::size_t(camara.samples_per_pixel);
+  auto const lado  = std::size_t(camara.tile_size);
+  auto const teselas_imagen = ((ancho + lado - 1) / lado) * ((alto + lado - 1) / lado);
+  auto const trozos         = trozos_por_pixel(teselas_imagen, spp);
+  ToneMapper const tono(camara.gamma);
+
+  std::size_t siguiente = 0;
+  auto const repartir   = [&](tbb::flow_control & control) -> std::size_t {
+    if (siguiente >= alto) {
+      control.stop();
+      return 0;
+    }
+    auto const fila0  = siguiente;
+    siguiente        += lado;
+    return fila0;
+  };
+  auto const trazar = [&](std::size_t fila0) {
+    return trazar_banda(camara, escena, fila0, std::min(lado, alto - fila0), trozos, tono);
+  };
+  auto const entregar = [&](Banda const & banda) { on_band(banda.pixeles, int(banda.fila0)); };
+
+  // Cada token del pipeline lleva una banda, asi que nunca hay mas de max_bands vivas.
+  using tbb::filter_mode;
+  tbb::parallel_pipeline(std::size_t(max_bands),
+                         tbb::make_filter<void, std::size_t>(filter_mode::serial_in_order,
+                                                             repartir) &
+                             tbb::make_filter<std::size_t, Banda>(filter_mode::parallel, trazar) &
+                             tbb::make_filter<Banda, void>(filter_mode::serial_in_order, entregar));
+  return {std::uint64_t(ancho * alto * spp), {}};
+}
+
+HitRecord closest_hit(Ray const & rayo, RenderScene const & escena,
+                      IntersectKernels const & kernels) {
+  HitRecord hit;
+  buscar_intersecciones(rayo, escena, kernels, hit);
+  return hit;
+}
+
+HitRecord closest_hit_linear(Ray const & rayo, RenderScene const & escena) {
+  // Las ranuras estan en orden de hojas; se recorren por id para que, con el '<' estricto
+  // de las funciones escalares, a igual distancia gane el id menor.
+  std::size_t const num_esferas = escena.num_spheres();
+  std::vector<std::uint32_t> ranura_de(num_esferas + escena.num_cylinders());
+  for (std::size_t s = 0; s < num_esferas; ++s) {
+    ranura_de.at(escena.spheres.id[s]) = std::uint32_t(s);
+  }
+  for (std::size_t s = 0; s < escena.num_cylinders(); ++s) {
+    ranura_de.at(escena.cylinders.id[s]) = std::uint32_t(s);
+  }
+
+  HitRecord hit;
+  for (std::size_t id = 0; id < ranura_de.size(); ++id) {
+    if (id < num_esferas) {
+      intersectar_esfera(rayo, escena.spheres.get(ranura_de[id]), hit);
+    } else {
+      intersectar_cilindro(rayo, escena.cylinders.get(ranura_de[id]), hit);
+    }
+  }
+  return hit;
 }
@@ -0,0 +1,248 @@
+#include "../include/render_scene.hpp"
+#include "../include/bvh.hpp"
+#include "../include/scene.hpp"
+#include "../include/vector3.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace {
+
+  // Boxes are grown slightly so that rounding in the slab test never culls a hit
+  // the brute-force loop would have found.
+  constexpr double BOX_PADDING = 1e-6;
+
+  Aabb padded(Aabb b) {
+    for (std::size_t i = 0; i < 3; ++i) {
+      double const pad =
+          BOX_PADDING * (1.0 + std::max(std::abs(b.lo.at(i)), std::abs(b.hi.at(i))));
+      b.lo.at(i) -= pad;
+      b.hi.at(i) += pad;
+    }
+    return b;
+  }
+
+  RenderMaterial compile_material(Material const & m) {
+    switch (m.type) {
+      case MaterialType::Matte:      return {m.matte.rgb, 0.0};
+      case MaterialType::Metal:      return {m.metal.rgb, m.metal.diffusion};
+      case MaterialType::Refractive: return {{}, m.refr.index};
+    }
+    return {};
+  }
+
+  RenderSphere compile_sphere(Sphere const & s, std::span<std::uint32_t const> refs) {
+    RenderSphere out{};
+    out.center      = s.center;
+    out.radius2     = s.radius * s.radius;
+    out.material_id = refs[s.material_id];
+    return out;
+  }
+
+  Aabb sphere_bounds(Sphere const & s) {
+    Aabb b;
+    for (std::size_t i = 0; i < 3; ++i) {
+      b.lo.at(i) = s.center.at(i) - s.radius;
+      b.hi.at(i) = s.center.at(i) + s.radius;
+    }
+    return padded(b);
+  }
+
+  // The cylinder is centred on base_center and spans half the axis to each side.
+  RenderCylinder compile_cylinder(Cylinder const & c, std::span<std::uint32_t const> refs) {
+    RenderCylinder out{};
+    out.center           = c.base_center;
+    out.axis             = normalize(c.axis);
+    out.half_height      = length(c.axis) / 2.0;
+    out.radius           = c.radius;
+    out.radius2          = c.radius * c.radius;
+    auto const half_axis = mul(c.axis, 0.5);
+    out.cap_lo           = sub(c.base_center, half_axis);
+    out.cap_hi           = add(c.base_center, half_axis);
+    out.normal_lo        = mul(out.axis, -1.0);
+    out.material_id      = refs[c.material_id];
+    return out;
+  }
+
+  // Both caps are discs perpendicular to the axis, so along each world axis the
+  // cylinder extends past the cap centres by radius * sqrt(1 - axis_i^2).
+  Aabb cylinder_bounds(RenderCylinder const & c) {
+    Aabb b;
+    for (std::size_t i = 0; i < 3; ++i) {
+      double const a    = c.axis.at(i);
+      double const disc = c.radius * std::sqrt(std::max(0.0, 1.0 - a * a));
+      b.lo.at(i)        = std::min(c.cap_lo.at(i), c.cap_hi.at(i)) - disc;
+      b.hi.at(i)        = std::max(c.cap_lo.at(i), c.cap_hi.at(i)) + disc;
+    }
+    return padded(b);
+  }
+
+  // Owning arrays behind a compiled RenderScene's views.
+  struct SphereColumns {
+    std::vector<double> cx, cy, cz;
+    std::vector<double> r2;
+    std::vector<std::uint32_t> material_id;
+    std::vector<std::uint32_t> id;
+  };
+
+  struct CylinderColumns {
+    std::vector<double> cx, cy, cz;
+    std::vector<double> ax, ay, az;
+    std::vector<double> lox, loy, loz;
+    std::vector<double> hix, hiy, hiz;
+    std::vector<double> half_height;
+    std::vector<double> radius;
+    std::vector<double> r2;
+    std::vector<std::uint32_t> material_id;
+    std::vector<std::uint32_t> id;
+  };
+
+  struct CompiledArrays {
+    std::vector<RenderMaterial> materials;
+    std::vector<std::uint64_t> name_offsets;
+    std::string names;
+    SphereColumns spheres;
+    CylinderColumns cylinders;
+    std::vector<Aabb> bounds;
+    Bvh bvh;
+  };
+
+  void push_sphere(SphereColumns & soa, RenderSphere const & s, std::uint32_t id) {
+    soa.cx.push_back(s.center[0]);
+    soa.cy.push_back(s.center[1]);
+    soa.cz.push_back(s.center[2]);
+    soa.r2.push_back(s.radius2);
+    soa.material_id.push_back(s.material_id);
+    soa.id.push_back(id);
+  }
+
+  void push_cylinder(CylinderColumns & soa, RenderCylinder const & c, std::uint32_t id) {
+    soa.cx.push_back(c.center[0]);
+    soa.cy.push_back(c.center[1]);
+    soa.cz.push_back(c.center[2]);
+    soa.ax.push_back(c.axis[0]);
+    soa.ay.push_back(c.axis[1]);
+    soa.az.push_back(c.axis[2]);
+    soa.lox.push_back(c.cap_lo[0]);
+    soa.loy.push_back(c.cap_lo[1]);
+    soa.loz.push_back(c.cap_lo[2]);
+    soa.hix.push_back(c.cap_hi[0]);
+    soa.hiy.push_back(c.cap_hi[1]);
+    soa.hiz.push_back(c.cap_hi[2]);
+    soa.half_height.push_back(c.half_height);
+    soa.radius.push_back(c.radius);
+    soa.r2.push_back(c.radius2);
+    soa.material_id.push_back(c.material_id);
+    soa.id.push_back(id);
+  }
+
+  // Unit of the block copy_render_scene allocates; keeps every array 64-byte aligned.
+  struct alignas(64) CacheLine {
+    std::array<std::byte, 64> bytes;
+  };
+
+  SphereSoA view(SphereColumns const & s) {
+    return {s.cx, s.cy, s.cz, s.r2, s.material_id, s.id};
+  }
+
+  CylinderSoA view(CylinderColumns const & c) {
+    return {c.cx,  c.cy,  c.cz,  c.ax,  c.ay,          c.az,     c.lox, c.loy,       c.loz,
+            c.hix, c.hiy, c.hiz, c.half_height, c.radius, c.r2,  c.material_id, c.id};
+  }
+
+}  // namespace
+
+RenderScene compile_scene(Scene const & scene) {
+  if (scene.materials.size() > std::size_t{MATERIAL_INDEX_MASK} + 1) {
+    std::cerr << "Error: Too many materials: " << scene.materials.size() << "\n";
+    std::exit(EXIT_FAILURE);
+  }
+  auto arrays = std::make_shared<CompiledArrays>();
+  RenderScene rs;
+
+  std::vector<std::uint32_t> refs;
+  refs.reserve(scene.materials.size());
+  arrays->materials.reserve(scene.materials.size());
+  arrays->name_offsets.reserve(scene.materials.size() + 1);
+  arrays->name_offsets.push_back(0);
+  for (auto const & m : scene.materials) {
+    refs.push_back(material_ref(m.type, static_cast<std::uint32_t>(refs.size())));
+    arrays->materials.push_back(compile_material(m));
+    arrays->names += m.name;
+    arrays->name_offsets.push_back(arrays->names.size());
+  }
+
+  std::vector<RenderSphere> spheres;
+  std::vector<RenderCylinder> cylinders;
+  spheres.reserve(scene.spheres.size());
+  cylinders.reserve(scene.cylinders.size());
+  arrays->bounds.reserve(scene.spheres.size() + scene.cylinders.size());
+
+  for (auto const & s : scene.spheres) {
+    spheres.push_back(compile_sphere(s, refs));
+    arrays->bounds.push_back(sphere_bounds(s));
+  }
+  for (auto const & c : scene.cylinders) {
+    cylinders.push_back(compile_cylinder(c, refs));
+    arrays->bounds.push_back(cylinder_bounds(cylinders.back()));
+  }
+
+  auto const num_spheres = static_cast<std::uint32_t>(spheres.size());
+  arrays->bvh            = build_bvh(arrays->bounds, num_spheres);
+
+  // Lay the primitives out in leaf order, then pad with zeroed slots the kernels
+  // mask off.
+  for (std::uint32_t const i : arrays->bvh.sphere_ids) {
+    push_sphere(arrays->spheres, spheres[i], i);
+  }
+  for (std::uint32_t const i : arrays->bvh.cylinder_ids) {
+    push_cylinder(arrays->cylinders, cylinders[i], num_spheres + i);
+  }
+  for (std::size_t k = 0; k < SIMD_PADDING; ++k) {
+    push_sphere(arrays->spheres, RenderSphere{}, 0);
+    push_cylinder(arrays->cylinders, RenderCylinder{}, 0);
+  }
+
+  rs.materials      = arrays->materials;
+  rs.material_names = {arrays->name_offsets, arrays->names};
+  rs.spheres        = view(arrays->spheres);
+  rs.cylinders      = view(arrays->cylinders);
+  rs.bounds         = arrays->bounds;
+  rs.bvh            = {arrays->bvh.nodes, num_spheres};
+  rs.storage        = std::move(arrays);
+  return rs;
+}
+
+RenderScene copy_render_scene(RenderScene const & rs) {
+  std::size_t lines = 0;
+  for_each_array(rs, [&](auto const & array) {
+    lines += (array.size_bytes() + sizeof(CacheLine) - 1) / sizeof(CacheLine);
+  });
+  auto block = std::make_shared<std::vector<CacheLine>>(lines);
+
+  RenderScene out  = rs;
+  std::size_t next = 0;
+  for_each_array(out, [&](auto & array) {
+    using T                = typename std::remove_reference_t<decltype(array)>::element_type;
+    CacheLine * const dest = block->data() + next;
+    if (not array.empty()) {
+      std::memcpy(dest, array.data(), array.size_bytes());
+    }
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    array = {reinterpret_cast<T *>(dest), array.size()};
+    next += (array.size_bytes() + sizeof(CacheLine) - 1) / sizeof(CacheLine);
+  });
+  out.storage = std::move(block);
+  return out;
+}
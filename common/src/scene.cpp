@@ -1,46 +1,54 @@
 #include "../include/scene.hpp"
+#include "../include/mapped_file.hpp"
+#include <algorithm>
 #include <array>
 #include <cctype>
+#include <charconv>
 #include <cmath>
+#include <cstddef>
 #include <cstdint>
 #include <cstdlib>
 #include <filesystem>
-#include <fstream>
+#include <functional>
 #include <iostream>
-#include <sstream>
+#include <limits>
+#include <optional>
+#include <span>
+#include <stdexcept>
 #include <string>
 #include <string_view>
-#include <unordered_map>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <oneapi/tbb/parallel_for.h>
 
 namespace {
 
-  inline void ltrim(std::string & s) {
-    std::size_t i = 0;
-    while (i < s.size() and std::isspace(static_cast<unsigned char>(s[i])) != 0) {
-      ++i;
-    }
-    s.erase(0, i);
+  // isspace in the "C" locale, which is what the stream extractors this parser replaced
+  // used to split words and numbers.
+  constexpr bool is_space(char c) {
+    return c == ' ' or (c >= '\t' and c <= '\r');
   }
 
-  inline void rtrim(std::string & s) {
-    if (s.empty()) {
-      return;
-    }
-    std::size_t i = s.size();
-    while (i > 0 and std::isspace(static_cast<unsigned char>(s[i - 1])) != 0) {
-      --i;
-    }
-    s.erase(i);
+  constexpr bool is_digit(char c) {
+    return c >= '0' and c <= '9';
   }
 
-  inline void trim(std::string & s) {
-    ltrim(s);
-    rtrim(s);
+  inline std::string_view trim(std::string_view s) {
+    std::size_t b = 0;
+    while (b < s.size() and is_space(s[b])) {
+      ++b;
+    }
+    std::size_t e = s.size();
+    while (e > b and is_space(s[e - 1])) {
+      --e;
+    }
+    return s.substr(b, e - b);
   }
 
-  inline bool is_comment_or_empty(std::string const & line) {
-    std::string t = line;
-    trim(t);
+  inline bool is_comment_or_empty(std::string_view line) {
+    std::string_view const t = trim(line);
     return t.empty() or t[0] == '#';
   }
 
@@ -49,63 +57,167 @@ namespace {
     std::exit(EXIT_FAILURE);
   }
 
-  [[noreturn]] void fail_duplicate_material(std::string const & name) {
-    std::cerr << "Error: Material with name [" << name << "] already exists\n";
-    std::exit(EXIT_FAILURE);
+  // Raised by the fail_* helpers below with the exact diagnostic to print. Lines are parsed
+  // in parallel, so nothing can exit on the spot: parse_scene prints the diagnostic of the
+  // first failing line in file order.
+  struct ParseFailure : std::runtime_error {
+    using std::runtime_error::runtime_error;
+  };
+
+  // Duplicates are only found once the chunks are merged, outside any line.
+  [[nodiscard]] std::string duplicate_material_error(std::string_view name) {
+    return "Error: Material with name [" + std::string(name) + "] already exists\n";
   }
 
-  [[noreturn]] void fail_invalid_material_params(std::string const & tag) {
-    std::cerr << "Error: Invalid material parameters for: [" << tag << "]\n";
-    std::exit(EXIT_FAILURE);
+  [[noreturn]] void fail_invalid_material_params(std::string_view tag) {
+    throw ParseFailure("Error: Invalid material parameters for: [" + std::string(tag) + "]\n");
   }
 
-  [[noreturn]] void fail_extra_material_tail(std::string const & tag, std::string const & tail) {
-    std::cerr << "Error: Extra data after material parameters for: [" << tag << "] (Extra: " << tail
-              << ")\n";
-    std::exit(EXIT_FAILURE);
+  [[noreturn]] void fail_extra_material_tail(std::string_view tag, std::string const & tail) {
+    throw ParseFailure("Error: Extra data after material parameters for: [" + std::string(tag) +
+                       "] (Extra: " + tail + ")\n");
   }
 
-  [[noreturn]] void fail_unknown_entity(std::string const & tag) {
-    std::cerr << "Error: Unknown scene entity: " << tag << "\n";
-    std::exit(EXIT_FAILURE);
+  [[noreturn]] void fail_unknown_entity(std::string_view tag) {
+    throw ParseFailure("Error: Unknown scene entity: " + std::string(tag) + "\n");
   }
 
-  [[noreturn]] void fail_invalid_object_params(std::string const & tag) {
-    std::cerr << "Error: Invalid object parameters for: [" << tag << "]\n";
-    std::exit(EXIT_FAILURE);
+  [[noreturn]] void fail_invalid_object_params(std::string_view tag) {
+    throw ParseFailure("Error: Invalid object parameters for: [" + std::string(tag) + "]\n");
   }
 
-  [[noreturn]] void fail_unknown_material(std::string const & name) {
-    std::cerr << "Error: Material not found: [" << name << "]\n";
-    std::exit(EXIT_FAILURE);
+  [[noreturn]] void fail_unknown_material(std::string_view name) {
+    throw ParseFailure("Error: Material not found: [" + std::string(name) + "]\n");
   }
 
-  inline std::string tail_tokens(std::istringstream & iss) {
-    std::ostringstream os;
-    std::string w;
-    bool first = true;
-    while (iss >> w) {
-      if (!first) {
-        os << ' ';
+  // Exact powers of ten as doubles: 10^22 is the largest one a double holds exactly.
+  constexpr std::array<double, 23> POW10 = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                            1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                            1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+  // Mantissas up to 2^53 convert to double exactly.
+  constexpr std::uint64_t MAX_EXACT_MANTISSA = std::uint64_t{1} << 53U;
+
+  // The parameters of one line, read left to right without copying. Words and numbers
+  // follow operator>> on an istringstream exactly: both skip leading whitespace, a word
+  // runs to the next whitespace and a number takes the longest prefix num_get would, so
+  // "0.5x" reads 0.5 and leaves "x" for the next field.
+  class Fields {
+  public:
+    explicit Fields(std::string_view text) : text_(text) { }
+
+    bool word(std::string_view & out) {
+      skip_space();
+      std::size_t const begin = pos_;
+      while (pos_ < text_.size() and not is_space(text_[pos_])) {
+        ++pos_;
+      }
+      out = text_.substr(begin, pos_ - begin);
+      return not out.empty();
+    }
+
+    // Accepts what libstdc++'s num_get accepts: [+-] digits [. digits] [eE [+-] digits],
+    // with no inf, nan or hex. Overflow fails; underflow gives zero or a subnormal.
+    bool number(double & out) {
+      skip_space();
+      std::size_t const begin = pos_;
+      bool const negative     = pos_ < text_.size() and text_[pos_] == '-';
+      if (pos_ < text_.size() and (text_[pos_] == '+' or negative)) {
+        ++pos_;
+      }
+      // The digits are summed as they are scanned, for the fast path below.
+      std::uint64_t mantissa = 0;
+      std::size_t digits     = 0;
+      std::size_t decimals   = 0;
+      bool dot               = false;
+      bool sci               = false;
+      while (pos_ < text_.size()) {
+        char const c = text_[pos_];
+        if (is_digit(c)) {
+          if (not sci) {
+            mantissa  = mantissa * 10 + static_cast<std::uint64_t>(c - '0');
+            digits   += 1;
+            decimals += dot ? 1 : 0;
+          }
+        } else if (c == '.' and not dot and not sci) {
+          dot = true;
+        } else if ((c == 'e' or c == 'E') and not sci and digits > 0) {
+          sci = true;
+          if (pos_ + 1 < text_.size() and (text_[pos_ + 1] == '+' or text_[pos_ + 1] == '-')) {
+            ++pos_;
+          }
+        } else {
+          break;
+        }
+        ++pos_;
+      }
+
+      // Fast path for plain decimals, what scene generators write: with every digit in 53
+      // bits the value is one IEEE division of two exact doubles, which rounds correctly
+      // and so matches from_chars bit for bit.
+      if (not sci and digits > 0 and digits <= 19 and mantissa <= MAX_EXACT_MANTISSA and
+          decimals < POW10.size()) {
+        double const value = static_cast<double>(mantissa) / POW10.at(decimals);
+        out                = negative ? -value : value;
+        return true;
+      }
+
+      // num_get takes a leading '+', from_chars does not
+      std::string_view digits_text = text_.substr(begin, pos_ - begin);
+      if (digits_text.starts_with('+')) {
+        digits_text.remove_prefix(1);
       }
-      os << w;
-      first = false;
+      double value{};
+      char const * const last = digits_text.data() + digits_text.size();
+      auto const [end, ec]    = std::from_chars(digits_text.data(), last, value);
+      if (ec == std::errc::result_out_of_range) {
+        // Rare: let strtod tell overflow (rejected) from underflow (accepted).
+        value = std::strtod(std::string(digits_text).c_str(), nullptr);
+        if (std::isinf(value)) {
+          return false;
+        }
+      } else if (ec != std::errc{} or end != last) {
+        return false;
+      }
+      out = value;
+      return true;
+    }
+
+    // What is left, words separated by single spaces; empty if nothing is left.
+    std::string tail() {
+      std::string out;
+      std::string_view w;
+      while (word(w)) {
+        if (!out.empty()) {
+          out += ' ';
+        }
+        out += w;
+      }
+      return out;
     }
-    return os.str();
-  }
 
-  inline bool read_double(std::istringstream & iss, double & out) {
-    double v{};
-    if (!(iss >> v)) {
-      return false;
+  private:
+    void skip_space() {
+      while (pos_ < text_.size() and is_space(text_[pos_])) {
+        ++pos_;
+      }
     }
-    out = v;
-    return true;
+
+    std::string_view text_;
+    std::size_t pos_ = 0;
+  };
+
+  inline std::string tail_tokens(Fields & in) {
+    return in.tail();
   }
 
-  inline bool read_rgb(std::istringstream & iss, std::array<double, 3> & rgb) {
+  inline bool read_double(Fields & in, double & out) {
+    return in.number(out);
+  }
+
+  inline bool read_rgb(Fields & in, std::array<double, 3> & rgb) {
     for (int i = 0; i < 3; ++i) {
-      if (!read_double(iss, rgb.at(static_cast<std::size_t>(i)))) {
+      if (!read_double(in, rgb.at(static_cast<std::size_t>(i)))) {
         return false;
       }
     }
@@ -114,13 +226,11 @@ namespace {
            (rgb[2] >= 0.0 and rgb[2] <= 1.0);
   }
 
-  inline bool read3(std::istringstream & iss, std::array<double, 3> & v) {
+  inline bool read3(Fields & in, std::array<double, 3> & v) {
     for (int i = 0; i < 3; ++i) {
-      double x{};
-      if (!(iss >> x)) {
+      if (!read_double(in, v.at(static_cast<std::size_t>(i)))) {
         return false;
       }
-      v.at(static_cast<std::size_t>(i)) = x;
     }
     return true;
   }
@@ -129,36 +239,164 @@ namespace {
     return std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
   }
 
-  struct MaterialTable {
-    std::unordered_map<std::string, std::uint32_t> name_to_id;
+  // Offset of a line in the file. Chunks are parsed out of order; offsets put their lines
+  // back in file order.
+  using LinePos                  = std::size_t;
+  constexpr LinePos NO_LINE      = std::numeric_limits<LinePos>::max();
+  constexpr std::size_t NO_INDEX = std::numeric_limits<std::size_t>::max();
+
+  // Material name -> id, built in file order once every chunk is parsed. Open addressing
+  // over (hash, id) slots: a probe reads one slot and compares names only when the full
+  // hash matches, instead of chasing map nodes, which dominated the parse of scenes with
+  // one material per object. Names point into the scene file.
+  class MaterialTable {
+  public:
+    static constexpr std::uint32_t NO_MATERIAL = 0xFFFF'FFFFU;
+
+    [[nodiscard]] std::uint32_t find(std::string_view name) const {
+      if (slots_.empty()) {
+        return NO_MATERIAL;
+      }
+      std::size_t const h = std::hash<std::string_view>{}(name);
+      for (std::size_t i = h & mask();; i = (i + 1) & mask()) {
+        Slot const & slot = slots_[i];
+        if (slot.id == NO_MATERIAL) {
+          return NO_MATERIAL;
+        }
+        if (slot.hash == h and names_[slot.id] == name) {
+          return slot.id;
+        }
+      }
+    }
+
+    // line defining material id
+    [[nodiscard]] LinePos defined_at(std::uint32_t id) const { return lines_[id]; }
+
+    // Room for count names without rehashing.
+    void reserve(std::size_t count) {
+      std::size_t size = 64;
+      while (size < 2 * count) {
+        size *= 2;
+      }
+      if (size > slots_.size()) {
+        rehash(size);
+      }
+      names_.reserve(count);
+      lines_.reserve(count);
+    }
+
+    // Adds name with the next id, in one probe; false if it is already there.
+    bool add(std::string_view name, LinePos line) {
+      if (2 * (names_.size() + 1) > slots_.size()) {
+        rehash(std::max<std::size_t>(64, 2 * slots_.size()));
+      }
+      std::size_t const h = std::hash<std::string_view>{}(name);
+      std::size_t i       = h & mask();
+      for (; slots_[i].id != NO_MATERIAL; i = (i + 1) & mask()) {
+        if (slots_[i].hash == h and names_[slots_[i].id] == name) {
+          return false;
+        }
+      }
+      slots_[i] = {h, static_cast<std::uint32_t>(names_.size())};
+      names_.push_back(name);
+      lines_.push_back(line);
+      return true;
+    }
+
+  private:
+    struct Slot {
+      std::size_t hash = 0;
+      std::uint32_t id = NO_MATERIAL;
+    };
+
+    [[nodiscard]] std::size_t mask() const { return slots_.size() - 1; }
+
+    void insert(std::size_t h, std::uint32_t id) {
+      std::size_t i = h & mask();
+      while (slots_[i].id != NO_MATERIAL) {
+        i = (i + 1) & mask();
+      }
+      slots_[i] = {h, id};
+    }
+
+    void rehash(std::size_t size) {
+      std::vector<Slot> old(size);
+      old.swap(slots_);
+      for (Slot const & slot : old) {
+        if (slot.id != NO_MATERIAL) {
+          insert(slot.hash, slot.id);
+        }
+      }
+    }
+
+    std::vector<Slot> slots_;              // power-of-two size, at most half full
+    std::vector<std::string_view> names_;  // by id
+    std::vector<LinePos> lines_;           // by id
   };
 
-  inline std::uint32_t mat_id_or_die(MaterialTable const & mt, std::string const & name) {
-    auto it = mt.name_to_id.find(name);
-    if (it == mt.name_to_id.end()) {
+  // An object names its material; a material defined further down the file is as unknown
+  // as one never defined.
+  inline std::uint32_t mat_id_or_die(MaterialTable const & mt, std::string_view name,
+                                     LinePos line) {
+    std::uint32_t const id = mt.find(name);
+    if (id == MaterialTable::NO_MATERIAL or mt.defined_at(id) > line) {
       fail_unknown_material(name);
     }
-    return it->second;
+    return id;
   }
 
-  inline void add_matte(std::istringstream & iss, Scene & scn, MaterialTable & mt,
-                        std::string const & tag) {
-    std::string name;
-    if (!(iss >> name)) {
+  // Object whose material name is resolved after every chunk is parsed.
+  struct MaterialRef {
+    std::string_view name;
+    LinePos line = 0;
+  };
+
+  // Everything one chunk of lines parsed to, in file order, before material names are
+  // checked and resolved.
+  struct Chunk {
+    std::vector<Material> materials;
+    std::vector<std::string_view> material_names;
+    std::vector<LinePos> material_lines;
+    std::vector<Sphere> spheres;
+    std::vector<MaterialRef> sphere_refs;
+    std::vector<Cylinder> cylinders;
+    std::vector<MaterialRef> cylinder_refs;
+
+    // The first line that failed; parsing of the chunk stops there. A material line that
+    // failed after its name was read keeps the name: if it turns out to be a duplicate,
+    // that is the error the line reports, since names were checked first.
+    LinePos error_line = NO_LINE;
+    std::string error;
+    std::string_view error_material;
+
+    std::string_view line_material;  // name read on the current line, if a material
+  };
+
+  // Reads the material name; whether it is new is checked when the chunks are merged.
+  inline std::string_view read_material_name(Fields & in, Chunk & out, std::string_view tag) {
+    std::string_view name;
+    if (!in.word(name)) {
       fail_invalid_material_params(tag);
     }
+    out.line_material = name;
+    return name;
+  }
 
-    // NOLINTNEXTLINE(readability-container-contains)
-    if (mt.name_to_id.find(name) != mt.name_to_id.end()) {
-      fail_duplicate_material(name);
-    }
+  inline void push_material(Material m, std::string_view name, Chunk & out, LinePos line) {
+    out.materials.push_back(std::move(m));
+    out.material_names.push_back(name);
+    out.material_lines.push_back(line);
+  }
+
+  inline void add_matte(Fields & in, Chunk & out, std::string_view tag, LinePos line) {
+    std::string_view const name = read_material_name(in, out, tag);
 
     std::array<double, 3> rgb{};
-    if (!read_rgb(iss, rgb)) {
+    if (!read_rgb(in, rgb)) {
       fail_invalid_material_params(tag);
     }
 
-    std::string const extra = tail_tokens(iss);
+    std::string const extra = tail_tokens(in);
     if (!extra.empty()) {
       fail_extra_material_tail(tag, extra);
     }
@@ -167,33 +405,23 @@ namespace {
     m.name      = name;
     m.type      = MaterialType::Matte;
     m.matte.rgb = rgb;
-    scn.materials.push_back(m);
-    mt.name_to_id.emplace(name, static_cast<std::uint32_t>(scn.materials.size() - 1));
+    push_material(std::move(m), name, out, line);
   }
 
-  inline void add_metal(std::istringstream & iss, Scene & scn, MaterialTable & mt,
-                        std::string const & tag) {
-    std::string name;
-    if (!(iss >> name)) {
-      fail_invalid_material_params(tag);
-    }
-
-    // NOLINTNEXTLINE(readability-container-contains)
-    if (mt.name_to_id.find(name) != mt.name_to_id.end()) {
-      fail_duplicate_material(name);
-    }
+  inline void add_metal(Fields & in, Chunk & out, std::string_view tag, LinePos line) {
+    std::string_view const name = read_material_name(in, out, tag);
 
     std::array<double, 3> rgb{};
-    if (!read_rgb(iss, rgb)) {
+    if (!read_rgb(in, rgb)) {
       fail_invalid_material_params(tag);
     }
 
     double diffusion{};
-    if (!read_double(iss, diffusion) or diffusion < 0.0) {
+    if (!read_double(in, diffusion) or diffusion < 0.0) {
       fail_invalid_material_params(tag);
     }
 
-    std::string const extra = tail_tokens(iss);
+    std::string const extra = tail_tokens(in);
     if (!extra.empty()) {
       fail_extra_material_tail(tag, extra);
     }
@@ -203,28 +431,18 @@ namespace {
     m.type            = MaterialType::Metal;
     m.metal.rgb       = rgb;
     m.metal.diffusion = diffusion;
-    scn.materials.push_back(m);
-    mt.name_to_id.emplace(name, static_cast<std::uint32_t>(scn.materials.size() - 1));
+    push_material(std::move(m), name, out, line);
   }
 
-  inline void add_refractive(std::istringstream & iss, Scene & scn, MaterialTable & mt,
-                             std::string const & tag) {
-    std::string name;
-    if (!(iss >> name)) {
-      fail_invalid_material_params(tag);
-    }
-
-    // NOLINTNEXTLINE(readability-container-contains)
-    if (mt.name_to_id.find(name) != mt.name_to_id.end()) {
-      fail_duplicate_material(name);
-    }
+  inline void add_refractive(Fields & in, Chunk & out, std::string_view tag, LinePos line) {
+    std::string_view const name = read_material_name(in, out, tag);
 
     double index{};
-    if (!read_double(iss, index) or index <= 0.0) {
+    if (!read_double(in, index) or index <= 0.0) {
       fail_invalid_material_params(tag);
     }
 
-    std::string const extra = tail_tokens(iss);
+    std::string const extra = tail_tokens(in);
     if (!extra.empty()) {
       fail_extra_material_tail(tag, extra);
     }
@@ -233,8 +451,7 @@ namespace {
     m.name       = name;
     m.type       = MaterialType::Refractive;
     m.refr.index = index;
-    scn.materials.push_back(m);
-    mt.name_to_id.emplace(name, static_cast<std::uint32_t>(scn.materials.size() - 1));
+    push_material(std::move(m), name, out, line);
   }
 
   inline void ensure_file_exists(std::filesystem::path const & p) {
@@ -243,37 +460,35 @@ namespace {
     }
   }
 
-  inline void add_sphere(std::istringstream & iss, Scene & scn, MaterialTable const & mt,
-                         std::string const & tag) {
+  inline void add_sphere(Fields & in, Chunk & out, std::string_view tag, LinePos line) {
     std::array<double, 3> c{};
     double r{};
-    if (!read3(iss, c) or !(iss >> r) or r <= 0.0) {
+    if (!read3(in, c) or !read_double(in, r) or r <= 0.0) {
       fail_invalid_object_params(tag);
     }
 
-    std::string mname;
-    if (!(iss >> mname)) {
+    std::string_view mname;
+    if (!in.word(mname)) {
       fail_invalid_object_params(tag);
     }
 
-    std::string const extra = tail_tokens(iss);
+    std::string const extra = tail_tokens(in);
     if (!extra.empty()) {
       fail_extra_material_tail(tag, extra);
     }
 
     Sphere s{};
-    s.center      = c;
-    s.radius      = r;
-    s.material_id = mat_id_or_die(mt, mname);
-    scn.spheres.push_back(s);
+    s.center = c;
+    s.radius = r;
+    out.spheres.push_back(s);
+    out.sphere_refs.push_back({mname, line});
   }
 
-  inline void add_cylinder(std::istringstream & iss, Scene & scn, MaterialTable const & mt,
-                           std::string const & tag) {
+  inline void add_cylinder(Fields & in, Chunk & out, std::string_view tag, LinePos line) {
     std::array<double, 3> c{};
     double r{};
     std::array<double, 3> axis{};
-    if (!read3(iss, c) or !(iss >> r) or r <= 0.0 or !read3(iss, axis)) {
+    if (!read3(in, c) or !read_double(in, r) or r <= 0.0 or !read3(in, axis)) {
       fail_invalid_object_params(tag);
     }
 
@@ -281,12 +496,12 @@ namespace {
       fail_invalid_object_params(tag);
     }
 
-    std::string mname;
-    if (!(iss >> mname)) {
+    std::string_view mname;
+    if (!in.word(mname)) {
       fail_invalid_object_params(tag);
     }
 
-    std::string const extra = tail_tokens(iss);
+    std::string const extra = tail_tokens(in);
     if (!extra.empty()) {
       fail_extra_material_tail(tag, extra);
     }
@@ -295,69 +510,216 @@ namespace {
     cy.base_center = c;
     cy.radius      = r;
     cy.axis        = axis;
-    cy.material_id = mat_id_or_die(mt, mname);
-    scn.cylinders.push_back(cy);
+    out.cylinders.push_back(cy);
+    out.cylinder_refs.push_back({mname, line});
   }
 
-  inline void process_scene_line(std::string const & line, Scene & scn, MaterialTable & mt) {
-    std::string s = line;
-    trim(s);
-    std::string tag;
-    std::string rest;
-    if (auto pos = s.find(':'); pos != std::string::npos) {
+  // "tag: params" or "tag params"; the tag is matched case-insensitively.
+  inline void process_scene_line(std::string_view line, Chunk & out, LinePos pos) {
+    std::string_view const s = trim(line);
+    std::string_view tag;
+    std::string_view rest;
+    if (auto pos = s.find(':'); pos != std::string_view::npos) {
       tag  = s.substr(0, pos);
       rest = s.substr(pos + 1);
     } else {
-      std::istringstream iss(s);
-      iss >> tag;
-      std::getline(iss, rest);
+      Fields words(s);
+      words.word(tag);
+      rest = s.substr(tag.size());
     }
-    trim(tag);
-    trim(rest);
+    rest = trim(rest);
 
-    for (char & c : tag) {
+    // Tags are short: the lowered copy stays in the small-string buffer.
+    std::string lower(trim(tag));
+    for (char & c : lower) {
       c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
     }
 
-    std::istringstream iss(rest);
+    Fields in(rest);
 
-    if (tag == "matte") {
-      add_matte(iss, scn, mt, tag);
-    } else if (tag == "metal") {
-      add_metal(iss, scn, mt, tag);
-    } else if (tag == "refractive") {
-      add_refractive(iss, scn, mt, tag);
-    } else if (tag == "sphere") {
-      add_sphere(iss, scn, mt, tag);
-    } else if (tag == "cylinder") {
-      add_cylinder(iss, scn, mt, tag);
+    if (lower == "matte") {
+      add_matte(in, out, lower, pos);
+    } else if (lower == "metal") {
+      add_metal(in, out, lower, pos);
+    } else if (lower == "refractive") {
+      add_refractive(in, out, lower, pos);
+    } else if (lower == "sphere") {
+      add_sphere(in, out, lower, pos);
+    } else if (lower == "cylinder") {
+      add_cylinder(in, out, lower, pos);
     } else {
-      fail_unknown_entity(tag);
+      fail_unknown_entity(lower);
+    }
+  }
+
+  // Parses the lines of text, which starts at offset first in the file, until the first
+  // line that fails.
+  void parse_chunk(std::string_view text, LinePos first, Chunk & out) {
+    LinePos pos = first;
+    while (!text.empty()) {
+      std::size_t const eol       = text.find('\n');
+      std::string_view const line = text.substr(0, eol);
+      std::size_t const next      = eol == std::string_view::npos ? text.size() : eol + 1;
+      if (!is_comment_or_empty(line)) {
+        out.line_material = {};
+        try {
+          process_scene_line(line, out, pos);
+        } catch (ParseFailure const & failure) {
+          out.error_line     = pos;
+          out.error          = failure.what();
+          out.error_material = out.line_material;
+          return;
+        }
+      }
+      text.remove_prefix(next);
+      pos += next;
+    }
+  }
+
+  // Chunks of about CHUNK_BYTES that start and end on line boundaries: big enough to
+  // amortise a task, small enough to balance a multi-million-line scene over every core.
+  constexpr std::size_t CHUNK_BYTES = std::size_t{1} << 20U;
+
+  std::vector<std::size_t> chunk_starts(std::string_view text) {
+    std::size_t const count = std::max<std::size_t>(1, text.size() / CHUNK_BYTES);
+    std::vector<std::size_t> starts{0};
+    for (std::size_t i = 1; i < count; ++i) {
+      std::size_t const eol = text.find('\n', std::max(i * text.size() / count, starts.back()));
+      if (eol == std::string_view::npos) {
+        break;
+      }
+      if (eol + 1 > starts.back() and eol + 1 < text.size()) {
+        starts.push_back(eol + 1);
+      }
+    }
+    starts.push_back(text.size());
+    return starts;
+  }
+
+  // The failing line that comes first in the file, over every pass.
+  struct FirstError {
+    LinePos line = NO_LINE;
+    std::string message;
+
+    void keep(LinePos at, std::string text) {
+      if (at < line) {
+        line    = at;
+        message = std::move(text);
+      }
+    }
+  };
+
+  // Second pass over one chunk: names become ids and objects move to their place in the
+  // scene. Stops at the first unknown material or at stop, where an earlier error was
+  // already found.
+  template <typename Object>
+  void resolve_objects(std::vector<Object> const & objects, std::vector<MaterialRef> const & refs,
+                       MaterialTable const & mt, LinePos stop, std::span<Object> dest,
+                       FirstError & error) {
+    for (std::size_t i = 0; i < objects.size() and refs[i].line < stop; ++i) {
+      try {
+        dest[i]             = objects[i];
+        dest[i].material_id = mat_id_or_die(mt, refs[i].name, refs[i].line);
+      } catch (ParseFailure const & failure) {
+        error.keep(refs[i].line, failure.what());
+        return;
+      }
     }
   }
 
 }  // namespace
 
+// The file is mapped and read in place: lines and fields are string_views into the
+// mapping, and numbers are converted without streams (see Fields::number). Chunks of
+// lines are parsed in parallel; material definitions are then collected in file order and
+// object material names resolved in a second parallel pass. Objects keep file order and
+// the error printed is the one of the first failing line, as in a line-by-line parse.
 Scene parse_scene(std::string_view scene_path) {
   std::filesystem::path const p{std::string(scene_path)};
   ensure_file_exists(p);
 
-  Scene scn;
-  MaterialTable mt;
-
-  std::ifstream fin(p);
-  if (!fin) {
+  std::optional<MappedFile> file;
+  try {
+    file.emplace(p.string());
+  } catch (std::runtime_error const &) {
     std::cerr << "Error: Failed to open scene file: " << p.string() << "\n";
     std::exit(EXIT_FAILURE);
   }
 
-  std::string line;
-  while (std::getline(fin, line)) {
-    if (is_comment_or_empty(line)) {
-      continue;
+  std::string_view const text          = file->text();
+  std::vector<std::size_t> const starts = chunk_starts(text);
+  std::vector<Chunk> chunks(starts.size() - 1);
+  tbb::parallel_for(std::size_t{0}, chunks.size(), [&](std::size_t i) {
+    parse_chunk(text.substr(starts[i], starts[i + 1] - starts[i]), starts[i], chunks[i]);
+  });
+
+  // Only lines before the first failure count; every chunk stopped at its own.
+  FirstError error;
+  std::string_view error_material;
+  for (Chunk const & chunk : chunks) {
+    if (chunk.error_line != NO_LINE) {
+      error.keep(chunk.error_line, chunk.error);
+      error_material = chunk.error_material;
+      break;
     }
-    process_scene_line(line, scn, mt);
   }
 
+  std::vector<std::size_t> first_material{0};
+  std::vector<std::size_t> first_sphere{0};
+  std::vector<std::size_t> first_cylinder{0};
+  for (Chunk const & chunk : chunks) {
+    first_material.push_back(first_material.back() + chunk.materials.size());
+    first_sphere.push_back(first_sphere.back() + chunk.spheres.size());
+    first_cylinder.push_back(first_cylinder.back() + chunk.cylinders.size());
+  }
+
+  // Material names in file order: ids and duplicates come out as in a line-by-line parse.
+  // This is the only serial step, and it only hashes names.
+  MaterialTable mt;
+  mt.reserve(first_material.back());
+  for (Chunk const & chunk : chunks) {
+    for (std::size_t i = 0; i < chunk.materials.size(); ++i) {
+      LinePos const line = chunk.material_lines[i];
+      if (line >= error.line) {
+        break;
+      }
+      std::string_view const name = chunk.material_names[i];
+      if (!mt.add(name, line)) {
+        error.keep(line, duplicate_material_error(name));
+        error_material = {};
+        break;
+      }
+    }
+  }
+  if (!error_material.empty() and mt.find(error_material) != MaterialTable::NO_MATERIAL) {
+    error.message = duplicate_material_error(error_material);
+  }
+
+  // Everything moves to its place in the scene, in parallel, while object material names
+  // become ids. Past an error the scene is thrown away, so only lookups stop there.
+  Scene scn;
+  scn.materials.resize(first_material.back());
+  scn.spheres.resize(first_sphere.back());
+  scn.cylinders.resize(first_cylinder.back());
+  std::vector<FirstError> unresolved(chunks.size());
+  tbb::parallel_for(std::size_t{0}, chunks.size(), [&](std::size_t i) {
+    Chunk & chunk = chunks[i];
+    std::ranges::move(chunk.materials,
+                      scn.materials.begin() + static_cast<std::ptrdiff_t>(first_material[i]));
+    resolve_objects(chunk.spheres, chunk.sphere_refs, mt, error.line,
+                    std::span(scn.spheres).subspan(first_sphere[i], chunk.spheres.size()),
+                    unresolved[i]);
+    resolve_objects(chunk.cylinders, chunk.cylinder_refs, mt, error.line,
+                    std::span(scn.cylinders).subspan(first_cylinder[i], chunk.cylinders.size()),
+                    unresolved[i]);
+  });
+  for (FirstError & e : unresolved) {
+    error.keep(e.line, std::move(e.message));
+  }
+
+  if (error.line != NO_LINE) {
+    std::cerr << error.message;
+    std::exit(EXIT_FAILURE);
+  }
   return scn;
 }
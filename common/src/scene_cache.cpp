@@ -0,0 +1,462 @@
+#include "../include/scene_cache.hpp"
+#include "../include/mapped_file.hpp"
+#include "../include/render_scene.hpp"
+#include "../include/scene.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cerrno>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <initializer_list>
+#include <iostream>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
+#include <oneapi/tbb/parallel_for.h>
+
+namespace {
+
+  // ---------- Content hash ----------
+  // xxHash64-style: four independent lanes over 32-byte stripes, per block of the text.
+  // Blocks hash in parallel and are folded in order, so the result does not depend on
+  // the thread count.
+
+  constexpr std::uint64_t PRIME1 = 0x9E3779B185EBCA87ULL;
+  constexpr std::uint64_t PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+  constexpr std::uint64_t PRIME3 = 0x165667B19E3779F9ULL;
+  constexpr std::uint64_t PRIME4 = 0x85EBCA77C2B2AE63ULL;
+  constexpr std::uint64_t PRIME5 = 0x27D4EB2F165667C5ULL;
+
+  constexpr std::size_t HASH_BLOCK = std::size_t{1} << 20U;
+
+  [[nodiscard]] std::uint64_t load64(char const * p) {
+    std::uint64_t v{};
+    std::memcpy(&v, p, sizeof v);
+    return v;
+  }
+
+  [[nodiscard]] std::uint64_t lane_round(std::uint64_t acc, std::uint64_t input) {
+    return std::rotl(acc + input * PRIME2, 31) * PRIME1;
+  }
+
+  [[nodiscard]] std::uint64_t merge(std::uint64_t acc, std::uint64_t value) {
+    return (acc ^ lane_round(0, value)) * PRIME1 + PRIME4;
+  }
+
+  [[nodiscard]] std::uint64_t avalanche(std::uint64_t h) {
+    h ^= h >> 33U;
+    h *= PRIME2;
+    h ^= h >> 29U;
+    h *= PRIME3;
+    return h ^ (h >> 32U);
+  }
+
+  [[nodiscard]] std::uint64_t hash_block(std::string_view block) {
+    char const * p         = block.data();
+    char const * const end = p + block.size();
+    std::array<std::uint64_t, 4> lane{PRIME1 + PRIME2, PRIME2, 0, 0 - PRIME1};
+    for (; end - p >= 32; p += 32) {
+      for (std::size_t i = 0; i < lane.size(); ++i) {
+        lane.at(i) = lane_round(lane.at(i), load64(p + 8 * i));
+      }
+    }
+    std::uint64_t h = std::rotl(lane[0], 1) + std::rotl(lane[1], 7) + std::rotl(lane[2], 12) +
+                      std::rotl(lane[3], 18);
+    for (std::uint64_t const l : lane) {
+      h = merge(h, l);
+    }
+    for (; end - p >= 8; p += 8) {
+      h = merge(h, load64(p));
+    }
+    std::array<char, 8> tail{};
+    std::copy(p, end, tail.begin());
+    return merge(h, load64(tail.data()) ^ static_cast<std::uint64_t>(end - p));
+  }
+
+  // ---------- File layout ----------
+
+  constexpr std::array<char, 8> MAGIC{'R', 'T', 'S', 'C', 'E', 'N', 'E', '\0'};
+  // Bump whenever compile_scene or a cached struct changes what a scene compiles to.
+  constexpr std::uint32_t VERSION    = 2;
+  constexpr std::uint32_t ORDER_MARK = 0x01020304;
+  constexpr std::size_t ALIGNMENT    = 64;
+
+  struct Header {
+    std::array<char, 8> magic{};
+    std::uint32_t version{};
+    std::uint32_t byte_order{};  // ORDER_MARK as the writing machine stores it
+    std::uint32_t layout{};      // layout_key() of the writer
+    std::uint32_t num_sections{};
+    std::uint64_t text_hash{};
+    std::uint64_t text_size{};
+    std::uint32_t num_spheres{};
+    std::uint32_t padding{};
+  };
+
+  struct Section {
+    std::uint64_t offset{};  // from the start of the file, a multiple of ALIGNMENT
+    std::uint64_t count{};   // elements, not bytes
+  };
+
+  // Sizes the mapped arrays depend on; a build where any of them differs must not reuse
+  // the file.
+  [[nodiscard]] std::uint32_t layout_key() {
+    static_assert(sizeof(BvhNode) < 256 and sizeof(Aabb) < 256 and
+                  sizeof(RenderMaterial) < 256 and SIMD_PADDING < 256);
+    return static_cast<std::uint32_t>(sizeof(BvhNode) | (sizeof(Aabb) << 8U) |
+                                      (sizeof(RenderMaterial) << 16U) | (SIMD_PADDING << 24U));
+  }
+
+  [[nodiscard]] std::size_t num_sections() {
+    RenderScene const rs;
+    std::size_t n = 0;
+    for_each_array(rs, [&](auto const &) { ++n; });
+    return n;
+  }
+
+  [[nodiscard]] std::uint64_t align_up(std::uint64_t n) {
+    return (n + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+  }
+
+  // ---------- Writing ----------
+
+  struct Blob {
+    void const * data;
+    std::uint64_t bytes;
+    std::uint64_t count;
+  };
+
+  template <typename T>
+  [[nodiscard]] Blob blob(std::span<T const> array) {
+    return {array.data(), array.size_bytes(), array.size()};
+  }
+
+  [[noreturn]] void fail_errno(char const * call, int error) {
+    throw std::runtime_error(std::string(call) + " failed: " + std::strerror(error));
+  }
+
+  struct FileCloser {
+    void operator()(std::FILE * file) const noexcept {
+      if (file != nullptr) {
+        // NOLINTNEXTLINE(cert-err33-c,cppcoreguidelines-owning-memory)
+        (void) std::fclose(file);
+      }
+    }
+  };
+
+  using FilePtr = std::unique_ptr<std::FILE, FileCloser>;
+
+  void write_bytes(std::FILE * file, void const * data, std::size_t bytes) {
+    if (bytes > 0 and std::fwrite(data, 1, bytes, file) != bytes) {
+      fail_errno("fwrite", errno);
+    }
+  }
+
+  void write_file(std::string const & path, Header const & header,
+                  std::vector<Section> const & sections, std::vector<Blob> const & blobs) {
+    // NOLINTNEXTLINE(cppcoreguidelines-owning-memory)
+    FilePtr file(std::fopen(path.c_str(), "wb"));
+    if (file == nullptr) {
+      fail_errno("fopen", errno);
+    }
+    write_bytes(file.get(), &header, sizeof header);
+    write_bytes(file.get(), sections.data(), sections.size() * sizeof(Section));
+    std::uint64_t pos = sizeof header + sections.size() * sizeof(Section);
+    std::array<char, ALIGNMENT> const zeros{};
+    for (std::size_t i = 0; i < blobs.size(); ++i) {
+      write_bytes(file.get(), zeros.data(), sections[i].offset - pos);
+      write_bytes(file.get(), blobs[i].data, blobs[i].bytes);
+      pos = sections[i].offset + blobs[i].bytes;
+    }
+    if (std::fflush(file.get()) != 0) {
+      fail_errno("fflush", errno);
+    }
+    // NOLINTNEXTLINE(cppcoreguidelines-owning-memory)
+    if (std::fclose(file.release()) != 0) {
+      fail_errno("fclose", errno);
+    }
+  }
+
+  // ---------- Loading ----------
+
+  [[nodiscard]] bool fits(Section const & s, std::size_t element_size, std::size_t file_size) {
+    return s.offset % ALIGNMENT == 0 and s.offset <= file_size and
+           s.count <= (file_size - s.offset) / element_size;
+  }
+
+  [[nodiscard]] bool same_size(std::size_t n, std::initializer_list<std::size_t> sizes) {
+    return std::ranges::all_of(sizes, [n](std::size_t m) { return m == n; });
+  }
+
+  // Column lengths agree with each other and with the header, so every slot the BVH
+  // can name exists in every array, and the name offsets stay inside the names.
+  [[nodiscard]] bool consistent(RenderScene const & rs, std::uint32_t num_spheres) {
+    auto const & names = rs.material_names;
+    if (names.offsets.size() != rs.materials.size() + 1 or names.offsets.front() != 0 or
+        not std::ranges::is_sorted(names.offsets) or names.offsets.back() != names.chars.size()) {
+      return false;
+    }
+    auto const & s       = rs.spheres;
+    auto const & c       = rs.cylinders;
+    std::size_t const ns = s.cx.size();
+    std::size_t const nc = c.cx.size();
+    return ns >= SIMD_PADDING and nc >= SIMD_PADDING and ns - SIMD_PADDING == num_spheres and
+           same_size(ns, {s.cy.size(), s.cz.size(), s.r2.size(), s.material_id.size(),
+                          s.id.size()}) and
+           same_size(nc, {c.cy.size(), c.cz.size(), c.ax.size(), c.ay.size(), c.az.size(),
+                          c.lox.size(), c.loy.size(), c.loz.size(), c.hix.size(), c.hiy.size(),
+                          c.hiz.size(), c.half_height.size(), c.radius.size(), c.r2.size(),
+                          c.material_id.size(), c.id.size()}) and
+           rs.bounds.size() == ns + nc - 2 * SIMD_PADDING;
+  }
+
+  // Primitive columns: material references name a valid type and table entry, and ids
+  // stay in their kind's id range. The padding slots are never hit and are not checked.
+  [[nodiscard]] bool valid_primitives(std::span<std::uint32_t const> material_ids,
+                                      std::span<std::uint32_t const> ids, std::size_t count,
+                                      std::size_t num_materials, std::uint64_t first_id,
+                                      std::uint64_t end_id) {
+    for (std::size_t slot = 0; slot < count; ++slot) {
+      std::uint32_t const ref = material_ids[slot];
+      if (material_type(ref) > MaterialType::Refractive or
+          material_index(ref) >= num_materials or ids[slot] < first_id or ids[slot] >= end_id) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Every index the traversal follows stays inside its array: leaf runs inside the real
+  // primitive slots, children after their parent (so there are no cycles), split axes
+  // below 3 and no leaf deeper than the traversal stack allows.
+  [[nodiscard]] bool valid_nodes(std::span<BvhNode const> nodes, std::size_t num_spheres,
+                                 std::size_t num_cylinders) {
+    std::vector<std::uint8_t> depth(nodes.size(), 0);
+    for (std::size_t i = 0; i < nodes.size(); ++i) {
+      BvhNode const & node = nodes[i];
+      if (node.is_leaf()) {
+        if (std::size_t{node.offset} + node.count > num_spheres or
+            std::size_t{node.cyl_offset} + node.cyl_count > num_cylinders) {
+          return false;
+        }
+        continue;
+      }
+      if (node.axis >= 3 or node.offset <= i + 1 or node.offset >= nodes.size() or
+          depth[i] >= BVH_MAX_DEPTH) {
+        return false;
+      }
+      auto const child_depth = static_cast<std::uint8_t>(depth[i] + 1);
+      for (std::size_t const child : {i + 1, std::size_t{node.offset}}) {
+        depth[child] = std::max(depth[child], child_depth);
+      }
+    }
+    return true;
+  }
+
+  // A cache whose header matches can still be damaged inside; an index out of range
+  // would crash every later render of the scene instead of rebuilding the file.
+  [[nodiscard]] bool valid_indices(RenderScene const & rs) {
+    std::size_t const ns    = rs.num_spheres();
+    std::size_t const nc    = rs.num_cylinders();
+    std::size_t const nmats = rs.materials.size();
+    return valid_primitives(rs.spheres.material_id, rs.spheres.id, ns, nmats, 0, ns) and
+           valid_primitives(rs.cylinders.material_id, rs.cylinders.id, nc, nmats, ns, ns + nc) and
+           valid_nodes(rs.bvh.nodes, ns, nc);
+  }
+
+  // Other caches of the same scene file were made for earlier versions of its text.
+  void remove_stale_caches(std::string const & scene_path, std::string const & keep) {
+    namespace fs = std::filesystem;
+    fs::path const scene(scene_path);
+    std::string const prefix      = scene.filename().string() + ".";
+    std::string_view const suffix = ".scache";
+    fs::path const kept           = fs::path(keep).filename();
+    fs::path const dir = scene.has_parent_path() ? scene.parent_path() : fs::path(".");
+    std::error_code ec;
+    for (fs::directory_iterator it(dir, ec), end; not ec and it != end; it.increment(ec)) {
+      std::string const name = it->path().filename().string();
+      if (name.size() == prefix.size() + 16 + suffix.size() and name.starts_with(prefix) and
+          name.ends_with(suffix) and name != kept and
+          name.find_first_not_of("0123456789abcdef", prefix.size()) ==
+              name.size() - suffix.size()) {
+        std::error_code ignored;
+        fs::remove(it->path(), ignored);
+      }
+    }
+  }
+
+}  // namespace
+
+std::uint64_t scene_text_hash(std::string_view text) {
+  std::size_t const blocks = (text.size() + HASH_BLOCK - 1) / HASH_BLOCK;
+  std::vector<std::uint64_t> block_hash(blocks);
+  tbb::parallel_for(std::size_t{0}, blocks, [&](std::size_t i) {
+    block_hash[i] = hash_block(text.substr(i * HASH_BLOCK, HASH_BLOCK));
+  });
+  std::uint64_t h = PRIME5 + text.size();
+  for (std::uint64_t const b : block_hash) {
+    h = merge(h, b);
+  }
+  return avalanche(h);
+}
+
+std::string scene_cache_path(std::string const & scene_path, std::uint64_t text_hash) {
+  std::array<char, 16> hex{};
+  std::ranges::fill(hex, '0');
+  std::array<char, 16> digits{};
+  auto const [end, ec] = std::to_chars(digits.begin(), digits.end(), text_hash, 16);
+  std::copy(digits.begin(), end, hex.end() - (end - digits.begin()));
+  return scene_path + "." + std::string(hex.data(), hex.size()) + ".scache";
+}
+
+bool load_scene_cache(std::string const & cache_path, std::uint64_t text_hash,
+                      std::uint64_t text_size, RenderScene & out) {
+  std::shared_ptr<MappedFile const> file;
+  try {
+    // The render reads the arrays in no particular order: fault them all in now.
+    file = std::make_shared<MappedFile const>(cache_path, FileAccess::whole);
+  } catch (std::runtime_error const &) {
+    return false;
+  }
+  // The views need the alignment only a mapping guarantees.
+  if (not file->mapped() or file->size() < sizeof(Header)) {
+    return false;
+  }
+  Header header;
+  std::memcpy(&header, file->data(), sizeof header);
+  std::size_t const n = num_sections();
+  if (header.magic != MAGIC or header.version != VERSION or header.byte_order != ORDER_MARK or
+      header.layout != layout_key() or header.num_sections != n or
+      header.text_hash != text_hash or header.text_size != text_size or
+      file->size() < sizeof header + n * sizeof(Section)) {
+    return false;
+  }
+  std::vector<Section> sections(n);
+  std::memcpy(sections.data(), file->data() + sizeof header, n * sizeof(Section));
+
+  RenderScene rs;
+  std::size_t next = 0;
+  bool ok          = true;
+  auto const bind  = [&](auto & array) {
+    using T           = typename std::remove_reference_t<decltype(array)>::element_type;
+    Section const & s = sections[next++];
+    if (not fits(s, sizeof(T), file->size())) {
+      ok = false;
+      return;
+    }
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    array = {reinterpret_cast<T *>(file->data() + s.offset), static_cast<std::size_t>(s.count)};
+  };
+  for_each_array(rs, bind);
+  rs.bvh.num_spheres = header.num_spheres;
+  if (not ok or not consistent(rs, header.num_spheres) or not valid_indices(rs)) {
+    return false;
+  }
+  rs.storage = std::move(file);
+  out        = std::move(rs);
+  return true;
+}
+
+void write_scene_cache(std::string const & cache_path, std::uint64_t text_hash,
+                       std::uint64_t text_size, RenderScene const & rs) {
+  std::vector<Blob> blobs;
+  for_each_array(rs, [&](auto const & array) { blobs.push_back(blob(array)); });
+
+  Header header;
+  header.magic        = MAGIC;
+  header.version      = VERSION;
+  header.byte_order   = ORDER_MARK;
+  header.layout       = layout_key();
+  header.num_sections = static_cast<std::uint32_t>(blobs.size());
+  header.text_hash    = text_hash;
+  header.text_size    = text_size;
+  header.num_spheres  = rs.bvh.num_spheres;
+
+  std::vector<Section> sections;
+  std::uint64_t pos = align_up(sizeof header + blobs.size() * sizeof(Section));
+  for (Blob const & b : blobs) {
+    sections.push_back({pos, b.count});
+    pos = align_up(pos + b.bytes);
+  }
+
+  std::string const tmp = cache_path + ".tmp" + std::to_string(::getpid());
+  try {
+    write_file(tmp, header, sections, blobs);
+    if (std::rename(tmp.c_str(), cache_path.c_str()) != 0) {
+      fail_errno("rename", errno);
+    }
+  } catch (...) {
+    (void) std::remove(tmp.c_str());
+    throw;
+  }
+}
+
+std::string_view scene_source_name(SceneSource source) {
+  switch (source) {
+    case SceneSource::cached:
+      return "cache";
+    case SceneSource::stored:
+      return "parsed, cached";
+    case SceneSource::parsed:
+      break;
+  }
+  return "parsed";
+}
+
+LoadedScene load_render_scene(std::string const & scene_path, bool use_cache, bool interleave) {
+  auto const compile = [&] { return compile_scene(parse_scene(scene_path)); };
+  std::error_code ec;
+  // Pipes and devices cannot be read twice; missing files are left to parse_scene to
+  // report.
+  if (not use_cache or not std::filesystem::is_regular_file(scene_path, ec)) {
+    return {compile(), SceneSource::parsed};
+  }
+  auto const hash_text = [&] {
+    MappedFile const text(scene_path);
+    return std::pair{scene_text_hash(text.text()), std::uint64_t{text.size()}};
+  };
+
+  std::pair<std::uint64_t, std::uint64_t> key;
+  try {
+    key = hash_text();
+  } catch (std::runtime_error const &) {
+    return {compile(), SceneSource::parsed};
+  }
+  auto const [hash, size]      = key;
+  std::string const cache_path = scene_cache_path(scene_path, hash);
+
+  LoadedScene out;
+  if (load_scene_cache(cache_path, hash, size, out.scene)) {
+    if (interleave) {
+      out.scene = copy_render_scene(out.scene);
+    }
+    out.source = SceneSource::cached;
+    return out;
+  }
+  out.scene = compile();
+  try {
+    // A text edited while it was being parsed must not be stored under the old hash.
+    if (hash_text() == key) {
+      write_scene_cache(cache_path, hash, size, out.scene);
+      remove_stale_caches(scene_path, cache_path);
+      out.source = SceneSource::stored;
+    }
+  } catch (std::runtime_error const & e) {
+    std::cerr << "Warning: scene cache " << cache_path << " not written: " << e.what() << "\n";
+  }
+  return out;
+}
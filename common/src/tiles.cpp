@@ -0,0 +1,81 @@
+#include "../include/tiles.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace {
+
+  // Spreads the low 16 bits of v so there is a zero bit between each of them.
+  [[nodiscard]] std::uint32_t spread_bits(std::uint32_t v) {
+    v &= 0x0000'FFFFU;
+    v  = (v | (v << 8U)) & 0x00FF'00FFU;
+    v  = (v | (v << 4U)) & 0x0F0F'0F0FU;
+    v  = (v | (v << 2U)) & 0x3333'3333U;
+    v  = (v | (v << 1U)) & 0x5555'5555U;
+    return v;
+  }
+
+  [[nodiscard]] std::uint64_t morton_key(std::uint32_t x, std::uint32_t y) {
+    return spread_bits(x) | (spread_bits(y) << 1U);
+  }
+
+  // Distance of (x, y) along the Hilbert curve filling an n x n grid, n a power of two.
+  [[nodiscard]] std::uint64_t hilbert_key(std::uint32_t x, std::uint32_t y, std::uint32_t n) {
+    std::uint64_t d = 0;
+    for (std::uint32_t s = n / 2; s > 0; s /= 2) {
+      std::uint32_t const rx = (x & s) != 0 ? 1U : 0U;
+      std::uint32_t const ry = (y & s) != 0 ? 1U : 0U;
+      d += std::uint64_t{s} * s * ((3U * rx) ^ ry);
+      // Rotate the quadrant so the sub-curve keeps its entry and exit corners.
+      if (ry == 0) {
+        if (rx == 1) {
+          x = s - 1 - (x & (s - 1));
+          y = s - 1 - (y & (s - 1));
+        }
+        std::swap(x, y);
+      }
+    }
+    return d;
+  }
+
+}  // namespace
+
+std::vector<Tile> make_tiles(int width, int height, int tile_size, TileOrder order) {
+  auto const w    = static_cast<std::uint32_t>(width);
+  auto const h    = static_cast<std::uint32_t>(height);
+  auto const size = static_cast<std::uint32_t>(std::max(tile_size, 1));
+  std::uint32_t const tiles_x = (w + size - 1) / size;
+  std::uint32_t const tiles_y = (h + size - 1) / size;
+
+  std::uint32_t side = 1;
+  while (side < std::max(tiles_x, tiles_y)) {
+    side *= 2;
+  }
+
+  std::vector<std::pair<std::uint64_t, Tile>> keyed;
+  keyed.reserve(std::size_t{tiles_x} * tiles_y);
+  for (std::uint32_t ty = 0; ty < tiles_y; ++ty) {
+    for (std::uint32_t tx = 0; tx < tiles_x; ++tx) {
+      std::uint64_t key = keyed.size();
+      if (order == TileOrder::morton) {
+        key = morton_key(tx, ty);
+      } else if (order == TileOrder::hilbert) {
+        key = hilbert_key(tx, ty, side);
+      }
+      Tile const tile{tx * size, ty * size, std::min((tx + 1) * size, w),
+                      std::min((ty + 1) * size, h)};
+      keyed.emplace_back(key, tile);
+    }
+  }
+  std::sort(keyed.begin(), keyed.end(),
+            [](auto const & a, auto const & b) { return a.first < b.first; });
+
+  std::vector<Tile> tiles;
+  tiles.reserve(keyed.size());
+  for (auto const & [key, tile] : keyed) {
+    tiles.push_back(tile);
+  }
+  return tiles;
+}
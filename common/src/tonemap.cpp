@@ -0,0 +1,186 @@
+#include "../include/tonemap.hpp"
+#include "tonemap_kernels.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+
+namespace {
+
+  constexpr int LEVELS                         = 255;  // highest byte value
+  constexpr std::uint32_t MIN_BITS             = 4;    // bins per octave: 2^MIN_BITS..
+  constexpr std::uint32_t MAX_BITS             = 16;   // ..2^MAX_BITS
+  constexpr std::uint32_t DOUBLE_MANTISSA_BITS = 52;
+  constexpr std::uint32_t FLOAT_MANTISSA_BITS  = 23;
+  constexpr int MIN_FLOAT_EXPONENT             = -126;  // smallest normal float
+  constexpr std::size_t GATHER_PADDING         = 3;
+
+  [[nodiscard]] std::int64_t double_key(double v, std::uint32_t bits) {
+    return std::int64_t(std::bit_cast<std::uint64_t>(v) >> (DOUBLE_MANTISSA_BITS - bits));
+  }
+
+  [[nodiscard]] std::int32_t float_key(float v, std::uint32_t shift) {
+    return std::int32_t(std::bit_cast<std::uint32_t>(v) >> shift);
+  }
+
+  // Same computation as the SIMD kernels, one value at a time.
+  [[nodiscard]] std::uint8_t map_float(kernels::ToneTable const & t, float v) {
+    v              = v > 0.0F ? std::min(v, 1.0F) : 0.0F;  // NaN goes to 0
+    auto const bin = std::clamp(float_key(v, t.shift) - t.first_bin, 0, t.last_bin);
+    auto k         = t.bins[bin];  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    return v >= t.thresholds[k + 1] ? std::uint8_t(k + 1) : k;
+  }
+
+  void tonemap_scalar(kernels::ToneTable const & table, float const * in,
+                      std::uint32_t const * counts, float scale, std::size_t n,
+                      std::uint8_t * out) {
+    // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    for (std::size_t i = 0; i < n; ++i) {
+      float const v = counts != nullptr ? in[i] / float(counts[i]) : in[i] * scale;
+      out[i]        = map_float(table, v);
+    }
+    // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  }
+
+  struct NamedKernel {
+    kernels::TonemapFn fn;
+    char const * name;
+  };
+
+  // Scalar first, then each wider set the running CPU supports.
+  struct KernelTable {
+    std::array<NamedKernel, 2> entries;
+    std::uint32_t count;
+  };
+
+  KernelTable detect_kernels() {
+    KernelTable table{};
+    table.entries.at(table.count++) = {tonemap_scalar, "scalar"};
+#if defined(RENDER_X86_KERNELS)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+      table.entries.at(table.count++) = {kernels::tonemap_avx2, "avx2"};
+    }
+#endif
+    return table;
+  }
+
+  KernelTable const & kernel_table() {
+    static KernelTable const table = detect_kernels();
+    return table;
+  }
+
+  // Whether no bin of 2^bits per octave holds two of the thresholds.
+  [[nodiscard]] bool separated(std::span<double const> levels, std::uint32_t bits) {
+    for (std::size_t k = 1; k < levels.size(); ++k) {
+      if (double_key(levels[k - 1], bits) == double_key(levels[k], bits)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+}  // namespace
+
+ToneMapper::ToneMapper(double gamma) : gamma_(gamma) {
+  // thresholds_[k] is where floor(255 * v^(1/gamma)) reaches k, i.e. (k / 255)^gamma.
+  for (int k = 1; k <= LEVELS; ++k) {
+    double const x = double(k) / double(LEVELS);
+    thresholds_.at(std::size_t(k)) = gamma > 0.0 ? std::pow(x, gamma) : x;
+  }
+  thresholds_.back() = std::numeric_limits<double>::infinity();
+  for (std::size_t k = 0; k < thresholds_.size(); ++k) {
+    thresholds_f_.at(k) = float(thresholds_.at(k));
+  }
+
+  // Bins start one octave below the first threshold, so everything under them maps to 0.
+  // The float layout has no bins below the normal range.
+  int const exponent = std::ilogb(thresholds_[1]) - 1;
+  if (thresholds_[1] == 0.0 or exponent < MIN_FLOAT_EXPONENT) {
+    exact_ = true;
+    return;
+  }
+  double const start = std::ldexp(1.0, exponent);
+  auto const levels  = std::span<double const>(thresholds_).subspan(1, LEVELS);
+
+  // The coarsest binning in which no bin holds two thresholds.
+  mantissa_bits_ = MIN_BITS;
+  while (not separated(levels, mantissa_bits_)) {
+    if (mantissa_bits_ == MAX_BITS) {
+      exact_ = true;
+      return;
+    }
+    ++mantissa_bits_;
+  }
+
+  first_bin_   = double_key(start, mantissa_bits_);
+  first_bin_f_ = float_key(float(start), FLOAT_MANTISSA_BITS - mantissa_bits_);
+  last_bin_    = std::int32_t(double_key(1.0, mantissa_bits_) - first_bin_);
+  bins_.assign(std::size_t(last_bin_) + 1 + GATHER_PADDING, 0);
+  for (std::int32_t b = 0; b <= last_bin_; ++b) {
+    auto const bits   = std::uint64_t(first_bin_ + b) << (DOUBLE_MANTISSA_BITS - mantissa_bits_);
+    double const edge = std::bit_cast<double>(bits);
+    bins_[std::size_t(b)] =
+        std::uint8_t(std::upper_bound(levels.begin(), levels.end(), edge) - levels.begin());
+  }
+}
+
+std::uint8_t ToneMapper::operator()(double v) const {
+  if (exact_) {
+    return map_pow(v);
+  }
+  v              = v > 0.0 ? std::min(v, 1.0) : 0.0;  // NaN goes to 0
+  auto const bin = std::clamp(double_key(v, mantissa_bits_) - first_bin_, std::int64_t{0},
+                              std::int64_t{last_bin_});
+  auto const k   = bins_[std::size_t(bin)];
+  return v >= thresholds_.at(std::size_t(k) + 1) ? std::uint8_t(k + 1) : k;
+}
+
+// The per-pixel pow the table replaces.
+std::uint8_t ToneMapper::map_pow(double v) const {
+  v = v > 0.0 ? std::min(v, 1.0) : 0.0;
+  if (gamma_ > 0.0) {
+    v = std::pow(v, 1.0 / gamma_);
+  }
+  return std::uint8_t(std::min(v * double(LEVELS), double(LEVELS)));
+}
+
+void ToneMapper::apply(float const * in, float scale, std::size_t n, std::uint8_t * out,
+                       std::uint32_t kernel) const {
+  apply_table(in, nullptr, scale, n, out, kernel);
+}
+
+void ToneMapper::apply(float const * sums, std::uint32_t const * counts, std::size_t n,
+                       std::uint8_t * out, std::uint32_t kernel) const {
+  apply_table(sums, counts, 1.0F, n, out, kernel);
+}
+
+void ToneMapper::apply_table(float const * in, std::uint32_t const * counts, float scale,
+                             std::size_t n, std::uint8_t * out, std::uint32_t kernel) const {
+  if (exact_) {
+    // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    for (std::size_t i = 0; i < n; ++i) {
+      float const v = counts != nullptr ? in[i] / float(counts[i]) : in[i] * scale;
+      out[i]        = map_pow(double(v));
+    }
+    // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    return;
+  }
+  KernelTable const & available = kernel_table();
+  kernels::ToneTable const table{bins_.data(), thresholds_f_.data(),
+                                 FLOAT_MANTISSA_BITS - mantissa_bits_, first_bin_f_, last_bin_};
+  available.entries.at(std::min(kernel, available.count - 1)).fn(table, in, counts, scale, n, out);
+}
+
+std::uint32_t num_tonemap_kernels() {
+  return kernel_table().count;
+}
+
+char const * tonemap_kernel_name(std::uint32_t index) {
+  return kernel_table().entries.at(index).name;
+}
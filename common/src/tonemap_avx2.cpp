@@ -0,0 +1,86 @@
+// Compiled with -mavx2: eight values per step, with the bin byte and the next threshold
+// fetched by gathers.
+#include "tonemap_kernels.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <immintrin.h>
+
+namespace {
+
+  // Byte of each lane, as 32-bit integers.
+  inline __m256i map8(kernels::ToneTable const & t, __m256 v) {
+    __m256 const zero = _mm256_setzero_ps();
+    // max with v first sends NaN to 0, like the scalar path.
+    v = _mm256_min_ps(_mm256_max_ps(v, zero), _mm256_set1_ps(1.0F));
+    __m256i bin = _mm256_srl_epi32(_mm256_castps_si256(v), _mm_cvtsi32_si128(int(t.shift)));
+    bin         = _mm256_sub_epi32(bin, _mm256_set1_epi32(t.first_bin));
+    bin = _mm256_min_epi32(_mm256_max_epi32(bin, _mm256_setzero_si256()),
+                           _mm256_set1_epi32(t.last_bin));
+    __m256i k = _mm256_and_si256(
+        _mm256_i32gather_epi32(reinterpret_cast<int const *>(t.bins), bin, 1),
+        _mm256_set1_epi32(0xFF));
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    __m256 const next = _mm256_i32gather_ps(t.thresholds + 1, k, 4);
+    // The comparison mask is -1 where v reaches the next threshold.
+    return _mm256_sub_epi32(k, _mm256_castps_si256(_mm256_cmp_ps(v, next, _CMP_GE_OQ)));
+  }
+
+  // Sixteen lanes of 0..255 to sixteen bytes in order.
+  inline __m128i pack16(__m256i a, __m256i b) {
+    __m256i const words = _mm256_packus_epi32(a, b);  // a0-3 b0-3 | a4-7 b4-7
+    __m256i const bytes = _mm256_packus_epi16(words, words);
+    __m256i const order = _mm256_permutevar8x32_epi32(bytes, _mm256_setr_epi32(0, 4, 1, 5, 0, 0,
+                                                                                0, 0));
+    return _mm256_castsi256_si128(order);
+  }
+
+  inline __m256 load8(float const * in, std::uint32_t const * counts, __m256 scale,
+                      std::size_t i) {
+    // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    __m256 const v = _mm256_loadu_ps(in + i);
+    if (counts == nullptr) {
+      return _mm256_mul_ps(v, scale);
+    }
+    __m256i const c = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(counts + i));
+    // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    return _mm256_div_ps(v, _mm256_cvtepi32_ps(c));
+  }
+
+}  // namespace
+
+namespace kernels {
+  // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+  void tonemap_avx2(ToneTable const & table, float const * in, std::uint32_t const * counts,
+                    float scale, std::size_t n, std::uint8_t * out) {
+    __m256 const vscale = _mm256_set1_ps(scale);
+    std::size_t i       = 0;
+    for (; i + 16 <= n; i += 16) {
+      __m256i const a = map8(table, load8(in, counts, vscale, i));
+      __m256i const b = map8(table, load8(in, counts, vscale, i + 8));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), pack16(a, b));
+    }
+    // The tail goes through the same vector code on a zero-padded copy.
+    if (i < n) {
+      alignas(32) float rest[16]         = {};  // NOLINT(modernize-avoid-c-arrays)
+      alignas(32) std::uint32_t ones[16] = {};  // NOLINT(modernize-avoid-c-arrays)
+      alignas(16) std::uint8_t bytes[16] = {};  // NOLINT(modernize-avoid-c-arrays)
+      for (std::size_t j = 0; j < n - i; ++j) {
+        rest[j] = in[i + j];
+        ones[j] = counts != nullptr ? counts[i + j] : 1U;
+      }
+      for (std::size_t j = n - i; j < 16; ++j) {
+        ones[j] = 1U;
+      }
+      std::uint32_t const * tail_counts = counts != nullptr ? ones : nullptr;
+      __m256i const a                   = map8(table, load8(rest, tail_counts, vscale, 0));
+      __m256i const b                   = map8(table, load8(rest, tail_counts, vscale, 8));
+      _mm_store_si128(reinterpret_cast<__m128i *>(bytes), pack16(a, b));
+      for (std::size_t j = 0; j < n - i; ++j) {
+        out[i + j] = bytes[j];
+      }
+    }
+  }
+
+  // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+}  // namespace kernels
@@ -0,0 +1,28 @@
+#pragma once
+// Plane tone-mapping kernels. One translation unit per instruction set, picked at run time
+// like the intersection kernels; the interface is plain pointers for the same reason.
+#include <cstddef>
+#include <cstdint>
+
+namespace kernels {
+
+  // What a kernel needs from ToneMapper, in float layout.
+  struct ToneTable {
+    std::uint8_t const * bins;  // readable 3 bytes past the last bin for 32-bit gathers
+    float const * thresholds;   // 257 entries
+    std::uint32_t shift;        // float bits >> shift = bin key
+    std::int32_t first_bin;     // key of bin 0
+    std::int32_t last_bin;
+  };
+
+  // out[i] = map(in[i] / counts[i]) if counts is not null, else map(in[i] * scale).
+  using TonemapFn = void (*)(ToneTable const & table, float const * in,
+                             std::uint32_t const * counts, float scale, std::size_t n,
+                             std::uint8_t * out);
+
+#if defined(RENDER_X86_KERNELS)
+  void tonemap_avx2(ToneTable const & table, float const * in, std::uint32_t const * counts,
+                    float scale, std::size_t n, std::uint8_t * out);
+#endif
+
+}  // namespace kernels
@@ -1,18 +1,102 @@
 #include "camera.hpp"
 #include "cli.hpp"
 #include "config.hpp"
+#include "execution.hpp"
 #include "framebuffer_soa.hpp"
+#include "intersect_simd.hpp"
 #include "ppm_writer.hpp"
 #include "rayos.hpp"
-#include "scene.hpp"
+#include "render_scene.hpp"
+#include "scene_cache.hpp"
+#include "tiles.hpp"
+#include <algorithm>
+#include <chrono>
 #include <cstddef>
+#include <exception>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <sstream>
+#include <string>
 #include <string_view>
 #include <vector>
 
 using namespace std;
 
+namespace {
+
+  // Per-tile seconds from the CSV an earlier render wrote with --tile-costs, if that render
+  // used the camera's tiles. Otherwise, on the first run for instance, returns none.
+  std::vector<double> read_tile_costs(std::string const & csv_path, Camera const & cam) {
+    std::ifstream csv(csv_path);
+    std::string line;
+    if (!std::getline(csv, line)) {
+      return {};
+    }
+    std::vector<Tile> const tiles =
+        make_tiles(cam.image_width, cam.image_height, cam.tile_size, cam.tile_order);
+    std::vector<double> seconds;
+    seconds.reserve(tiles.size());
+    while (std::getline(csv, line) and seconds.size() < tiles.size()) {
+      std::istringstream row(line);
+      std::size_t order{};
+      Tile tile{};
+      double ms{};
+      char c1{}, c2{}, c3{}, c4{}, c5{};
+      Tile const & expected = tiles[seconds.size()];
+      if (!(row >> order >> c1 >> tile.x0 >> c2 >> tile.y0 >> c3 >> tile.x1 >> c4 >> tile.y1 >>
+            c5 >> ms) or
+          order != seconds.size() or tile.x0 != expected.x0 or tile.y0 != expected.y0 or
+          tile.x1 != expected.x1 or tile.y1 != expected.y1 or !(ms >= 0.0)) {
+        return {};
+      }
+      seconds.push_back(ms / 1'000.0);
+    }
+    if (seconds.size() != tiles.size() or std::getline(csv, line)) {
+      return {};
+    }
+    return seconds;
+  }
+
+  // Prints a summary of the per-tile render times and, if asked, writes them all as CSV.
+  void report_tile_costs(RenderStats const & stats, int tile_size, std::string const & csv_path) {
+    if (stats.tiles.empty()) {
+      return;
+    }
+    std::vector<double> ms;
+    ms.reserve(stats.tiles.size());
+    for (auto const & t : stats.tiles) {
+      ms.push_back(t.seconds * 1'000.0);
+    }
+    std::sort(ms.begin(), ms.end());
+    double total = 0.0;
+    for (double const v : ms) {
+      total += v;
+    }
+    std::cout << "Tiles (count=" << ms.size() << ", size=" << tile_size
+              << ", ms min/median/max=" << ms.front() << "/" << ms[ms.size() / 2] << "/"
+              << ms.back() << ", mean=" << total / static_cast<double>(ms.size()) << ") \n";
+
+    if (csv_path.empty()) {
+      return;
+    }
+    std::ofstream csv(csv_path);
+    if (!csv) {
+      std::cerr << "Error: cannot write tile costs to " << csv_path << "\n";
+      return;
+    }
+    csv << "order,x0,y0,x1,y1,ms\n";
+    for (std::size_t i = 0; i < stats.tiles.size(); ++i) {
+      auto const & [tile, seconds] = stats.tiles[i];
+      csv << i << "," << tile.x0 << "," << tile.y0 << "," << tile.x1 << "," << tile.y1 << ","
+          << seconds * 1'000.0 << "\n";
+    }
+  }
+
+}  // namespace
+
 int main(int argc, char * argv[]) {
+  auto const start = std::chrono::steady_clock::now();
   std::vector<std::string_view> args;
   args.reserve(static_cast<size_t>(argc));
   for (int i = 0; i < argc; ++i) {
@@ -20,21 +104,40 @@ int main(int argc, char * argv[]) {
   }
 
   CLIArgs const cli = parse_cli(args, "render-soa");
+  setHugePagesSOA(cli.huge_pages);
   Config const cfg  = parse_config(cli.config_path);
   std::cout << "Config loaded (defaults): width=" << cfg.image_width << "\n";
 
-  Scene const scene = parse_scene(cli.scene_path);
+  LoadedScene const loaded = [&] {
+    // Every render thread reads the scene: with --numa its pages go to all nodes alike.
+    ScopedNumaInterleave const interleave(cli.numa);
+    return load_render_scene(cli.scene_path, cli.scene_cache, cli.numa);
+  }();
+  RenderScene const & escena = loaded.scene;
 
   Camera cam = make_camera_from_config(cfg);
+  if (cli.tile_size > 0) {
+    cam.tile_size = cli.tile_size;
+  }
+  if (!cli.tile_costs_path.empty()) {
+    // Costs of the previous run order this one; the file is then rewritten with its own.
+    cam.tile_costs = read_tile_costs(cli.tile_costs_path, cam);
+    std::cout << "Tile order: "
+              << (cam.tile_costs.empty() ? "curve (no matching costs)" : "longest first")
+              << "\n";
+  }
   std::cout << "Camera ready (" << cam.image_width << "x" << cam.image_height << ") \n";
   // Light sanity prints (avoid unused warnings)
   std::cout << "dx=(" << cam.dx[0] << "," << cam.dx[1] << "," << cam.dx[2] << ")\n";
   std::cout << "dy=(" << cam.dy[0] << "," << cam.dy[1] << "," << cam.dy[2] << ")\n";
 
   // Minimal output to avoid unused warnings and confirm flow
-  std::cout << "Scene loaded (materials=" << scene.materials.size()
-            << ", spheres=" << scene.spheres.size() << ", cylinders=" << scene.cylinders.size()
+  std::cout << "Scene loaded (materials=" << escena.materials.size()
+            << ", spheres=" << escena.num_spheres() << ", cylinders=" << escena.num_cylinders()
             << ") \n";
+  std::cout << "Scene compiled (BVH nodes=" << escena.bvh.nodes.size()
+            << ", kernels=" << intersect_kernels().name
+            << ", source=" << scene_source_name(loaded.source) << ") \n";
 
   std::cout << "Config: " << cli.config_path << "\n";
   std::cout << "Scene:  " << cli.scene_path << "\n";
@@ -45,10 +148,87 @@ int main(int argc, char * argv[]) {
   std::size_t const n =
       static_cast<std::size_t>(cam.image_width) * static_cast<std::size_t>(cam.image_height);
   FramebufferSOA fb;
-  fb.R.resize(n);
-  fb.G.resize(n);
-  fb.B.resize(n);
-  trace_rays_soa(cam, scene, fb);
-  writePPM_SOA(cli.output_path, fb, cam.image_width, cam.image_height);
+  ImageFormat format = image_format_from_path(cli.output_path);
+  if (cli.format == "p6") {
+    format = ImageFormat::p6;
+  } else if (cli.format == "pfm") {
+    format = ImageFormat::pfm;
+  } else if (cli.format == "p3") {
+    format = ImageFormat::p3;
+  }
+  bool const linear = format == ImageFormat::pfm or !cli.pfm_path.empty();
+
+  if (cli.mmap and cam.progressive_samples > 0) {
+    std::cerr << "Error: --mmap cannot be combined with progressive_samples\n";
+    return 1;
+  }
+  if (cli.stream_bands > 0 and (cam.progressive_samples > 0 or cam.adaptive_max_samples > 0)) {
+    std::cerr << "Error: --stream cannot be combined with progressive_samples or "
+                 "adaptive_max_samples\n";
+    return 1;
+  }
+
+  // Render and write inside one arena so --threads / --pin cover every parallel loop.
+  // The writers throw on I/O errors; with --mmap and --stream that happens mid-render.
+  ExecutionOptions const exec{cli.threads, cli.pin, cli.numa};
+  try {
+    run_in_arena(exec, [&] {
+      RenderStats stats{};
+      if (cli.mmap) {
+        // Render threads write finished pixels into the file mapping: nothing left to write.
+        MappedP6Image image(cli.output_path, cam.image_width, cam.image_height);
+        stats = trace_rays_rgb(cam, escena, image.pixels());
+        image.close();
+      } else if (cli.stream_bands > 0) {
+        // Each band is written as soon as it and every band above it are done.
+        BandWriter writer(cli.output_path, cam.image_width, cam.image_height, format);
+        stats = trace_rays_streaming(cam, escena, cli.stream_bands,
+                                     [&](FramebufferSOA const & band, int) { writer.write(band); });
+        writer.close();
+      } else if (cli.time_budget > 0.0) {
+        // The budget counts from program start; writing the image comes after the deadline.
+        auto const deadline =
+            start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                        std::chrono::duration<double>(cli.time_budget));
+        stats = trace_rays_until(cam, escena, fb, deadline);
+      } else if (cam.progressive_samples > 0) {
+        // Previews go through a temporary file so a reader never sees a half-written image.
+        std::string const preview = cli.output_path + ".part";
+        auto const target_samples = n * static_cast<std::size_t>(cam.samples_per_pixel);
+        auto last_write           = std::chrono::steady_clock::now();
+        auto const write_preview  = [&](FramebufferSOA const & img, RenderStats const & s) {
+          auto const now                              = std::chrono::steady_clock::now();
+          std::chrono::duration<double> const elapsed = now - last_write;
+          // Until the last pass the float planes hold sums, not means: no PFM previews.
+          if (s.samples < target_samples and elapsed.count() >= cam.progressive_interval and
+              format != ImageFormat::pfm) {
+            writeImage_SOA(preview, img, cam.image_width, cam.image_height, format);
+            std::filesystem::rename(preview, cli.output_path);
+            std::cout << "Pass written (spp=" << s.samples / n << ") \n";
+            last_write = now;
+          }
+          return true;
+        };
+        stats = trace_rays_progressive(cam, escena, fb, write_preview);
+      } else {
+        if (linear) {
+          initLinealSOA(fb, cam.image_width, cam.image_height);
+        }
+        stats = trace_rays_soa(cam, escena, fb);
+      }
+      std::cout << "Rendered (samples=" << stats.samples << ", mean spp="
+                << static_cast<double>(stats.samples) / static_cast<double>(n) << ") \n";
+      report_tile_costs(stats, cam.tile_size, cli.tile_costs_path);
+      if (!cli.mmap and cli.stream_bands == 0) {
+        writeImage_SOA(cli.output_path, fb, cam.image_width, cam.image_height, format);
+      }
+      if (!cli.pfm_path.empty()) {
+        writePFM_SOA(cli.pfm_path, fb, cam.image_width, cam.image_height);
+      }
+    });
+  } catch (std::exception const & e) {
+    std::cerr << "Error: cannot write image: " << e.what() << "\n";
+    return 1;
+  }
   return 0;
 }
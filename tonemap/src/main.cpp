@@ -0,0 +1,146 @@
+// Turns a linear PFM written by render-soa (--pfm or a .pfm output) into an 8-bit image,
+// so exposure and gamma can change without re-rendering.
+#include "framebuffer_soa.hpp"
+#include "ppm_writer.hpp"
+#include "tonemap.hpp"
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+#include <oneapi/tbb/blocked_range.h>
+#include <oneapi/tbb/parallel_for.h>
+
+namespace {
+
+  struct Options {
+    double gamma    = 2.2;  // same default as the render config
+    double exposure = 0.0;  // stops: every pixel is scaled by 2^exposure
+    std::string format;     // p3|p6; empty picks it from the output extension
+    std::string input_path;
+    std::string output_path;
+  };
+
+  [[noreturn]] void fail_usage(std::string_view exec_name) {
+    std::cerr << "Usage: " << exec_name
+              << " [--gamma <g>] [--exposure <stops>] [--format p3|p6] <input.pfm> <output.ppm>\n";
+    std::exit(EXIT_FAILURE);
+  }
+
+  [[noreturn]] void fail_option(std::string_view option, std::string_view text) {
+    std::cerr << "Error: Invalid " << option << " value: " << text << "\n";
+    std::exit(EXIT_FAILURE);
+  }
+
+  double parse_double(std::string_view option, std::string_view text) {
+    double value{};
+    auto const [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (ec != std::errc{} or end != text.data() + text.size() or not std::isfinite(value)) {
+      fail_option(option, text);
+    }
+    return value;
+  }
+
+  Options parse_options(std::vector<std::string_view> const & args) {
+    Options out;
+    std::vector<std::string_view> positional;
+    auto const value = [&](std::size_t & i) {
+      if (i + 1 == args.size()) {
+        fail_usage(args[0]);
+      }
+      return args[++i];
+    };
+    for (std::size_t i = 1; i < args.size(); ++i) {
+      if (args[i] == "--gamma") {
+        out.gamma = parse_double("--gamma", value(i));
+        if (out.gamma <= 0.0) {
+          fail_option("--gamma", args[i]);
+        }
+      } else if (args[i] == "--exposure") {
+        out.exposure = parse_double("--exposure", value(i));
+      } else if (args[i] == "--format") {
+        out.format = std::string(value(i));
+        if (out.format != "p3" and out.format != "p6") {
+          fail_option("--format", out.format);
+        }
+      } else {
+        positional.push_back(args[i]);
+      }
+    }
+    if (positional.size() != 2) {
+      fail_usage(args[0]);
+    }
+    out.input_path  = std::string(positional[0]);
+    out.output_path = std::string(positional[1]);
+    // the output is always 8-bit: a .pfm name would hold P3 or P6 data
+    if (image_format_from_path(out.output_path) == ImageFormat::pfm) {
+      std::cerr << "Error: Output must be a .ppm or .pnm image, not PFM: " << out.output_path
+                << "\n";
+      fail_usage(args[0]);
+    }
+    return out;
+  }
+
+}  // namespace
+
+int main(int argc, char * argv[]) {
+  std::vector<std::string_view> args;
+  args.reserve(static_cast<std::size_t>(argc));
+  for (int i = 0; i < argc; ++i) {
+    args.emplace_back(argv[i]);  // NOLINT
+  }
+  Options const opts = parse_options(args);
+
+  ImageFormat format = image_format_from_path(opts.output_path);
+  if (opts.format == "p6") {
+    format = ImageFormat::p6;
+  } else if (opts.format == "p3") {
+    format = ImageFormat::p3;
+  }
+
+  auto const start = std::chrono::steady_clock::now();
+  FramebufferSOA fb;
+  int width  = 0;
+  int height = 0;
+  try {
+    readPFM_SOA(opts.input_path, fb, width, height);
+  } catch (std::exception const & e) {
+    std::cerr << "Error: cannot read " << opts.input_path << ": " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  auto const w = static_cast<std::size_t>(width);
+  auto const h = static_cast<std::size_t>(height);
+  initFramebufferSOA(fb, width, height);
+  ToneMapper const tone(opts.gamma);
+  auto const scale = static_cast<float>(std::exp2(opts.exposure));
+  oneapi::tbb::parallel_for(
+      oneapi::tbb::blocked_range<std::size_t>(0, h),
+      [&](oneapi::tbb::blocked_range<std::size_t> const & rows) {
+        for (auto row = rows.begin(); row != rows.end(); ++row) {
+          auto const in  = row * fb.pasoLineal;
+          auto const out = row * w;
+          tone.apply(fb.linealR.data() + in, scale, w, fb.R.data() + out);
+          tone.apply(fb.linealG.data() + in, scale, w, fb.G.data() + out);
+          tone.apply(fb.linealB.data() + in, scale, w, fb.B.data() + out);
+        }
+      });
+  try {
+    writeImage_SOA(opts.output_path, fb, width, height, format);
+  } catch (std::exception const & e) {
+    std::cerr << "Error: cannot write " << opts.output_path << ": " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  std::chrono::duration<double, std::milli> const elapsed =
+      std::chrono::steady_clock::now() - start;
+  std::cout << "Tonemapped " << width << "x" << height << " (gamma=" << opts.gamma
+            << ", exposure=" << opts.exposure << ") in " << elapsed.count() << " ms\n";
+  return 0;
+}
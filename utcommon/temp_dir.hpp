@@ -0,0 +1,48 @@
+#pragma once
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+// A directory under the system temp dir, named after the running test and removed with
+// everything in it when the test ends.
+class TempDir {
+public:
+  TempDir() {
+    auto const * test = ::testing::UnitTest::GetInstance()->current_test_info();
+    std::string name  = std::string{"utcommon_"} + test->test_suite_name() + "_" + test->name();
+    std::ranges::replace(name, '/', '_');
+    path_ = std::filesystem::temp_directory_path() / name;
+    std::filesystem::remove_all(path_);
+    std::filesystem::create_directories(path_);
+  }
+
+  ~TempDir() {
+    std::error_code ec;
+    std::filesystem::remove_all(path_, ec);
+  }
+
+  TempDir(TempDir const &)             = delete;
+  TempDir & operator=(TempDir const &) = delete;
+
+  [[nodiscard]] std::filesystem::path const & path() const { return path_; }
+
+  [[nodiscard]] std::string file(std::string const & name) const {
+    return (path_ / name).string();
+  }
+
+  // Writes text to a file in the directory and returns its path.
+  [[nodiscard]] std::string write(std::string const & name, std::string_view text) const {
+    std::string const p = file(name);
+    std::ofstream out(p, std::ios::binary | std::ios::trunc);
+    out.write(text.data(), static_cast<std::streamsize>(text.size()));
+    return p;
+  }
+
+private:
+  std::filesystem::path path_;
+};
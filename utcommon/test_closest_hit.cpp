@@ -0,0 +1,182 @@
+#include "intersect_simd.hpp"
+#include "rayos.hpp"
+#include "render_scene.hpp"
+#include "scene.hpp"
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+  constexpr double SCENE_HALF_SIDE  = 5.0;
+  constexpr double ORIGIN_HALF_SIDE = 8.0;
+
+  class Generator {
+  public:
+    explicit Generator(std::uint64_t seed) : engine_(seed) {}
+
+    double uniform(double lo, double hi) {
+      return std::uniform_real_distribution<double>(lo, hi)(engine_);
+    }
+
+    std::array<double, 3> point(double half_side) {
+      return {uniform(-half_side, half_side), uniform(-half_side, half_side),
+              uniform(-half_side, half_side)};
+    }
+
+    std::uint32_t index(std::size_t count) {
+      return std::uniform_int_distribution<std::uint32_t>(0, std::uint32_t(count - 1))(engine_);
+    }
+
+    // From anywhere around the scene towards a point inside it.
+    Ray ray() {
+      auto const origin = point(ORIGIN_HALF_SIDE);
+      auto const target = point(SCENE_HALF_SIDE);
+      return {origin, {target[0] - origin[0], target[1] - origin[1], target[2] - origin[2]}};
+    }
+
+  private:
+    std::mt19937_64 engine_;
+  };
+
+  std::vector<Material> make_materials() {
+    return {
+      {"mate", MaterialType::Matte, {{0.1, 0.2, 0.3}}, {}, {}},
+      {"metal", MaterialType::Metal, {}, {{0.4, 0.5, 0.6}, 0.05}, {}},
+      {"vidrio", MaterialType::Refractive, {}, {}, {1.5}},
+      {"otro", MaterialType::Matte, {{0.7, 0.8, 0.9}}, {}, {}},
+    };
+  }
+
+  Scene random_scene(Generator & gen, std::size_t num_spheres, std::size_t num_cylinders) {
+    Scene scene;
+    scene.materials = make_materials();
+    for (std::size_t i = 0; i < num_spheres; ++i) {
+      scene.spheres.push_back(
+          {gen.point(SCENE_HALF_SIDE), gen.uniform(0.1, 1.0), gen.index(scene.materials.size())});
+    }
+    for (std::size_t i = 0; i < num_cylinders; ++i) {
+      scene.cylinders.push_back({gen.point(SCENE_HALF_SIDE), gen.uniform(0.05, 0.6),
+                                 gen.point(1.5), gen.index(scene.materials.size())});
+    }
+    return scene;
+  }
+
+  void expect_same_hit(HitRecord const & actual, HitRecord const & expected, std::size_t ray) {
+    EXPECT_EQ(actual.hit, expected.hit) << "ray " << ray;
+    EXPECT_EQ(actual.t, expected.t) << "ray " << ray;
+    EXPECT_EQ(actual.point, expected.point) << "ray " << ray;
+    EXPECT_EQ(actual.normal, expected.normal) << "ray " << ray;
+    EXPECT_EQ(actual.material_id, expected.material_id) << "ray " << ray;
+  }
+
+  // Closest hit of every kernel table against the linear reference.
+  class ClosestHit : public ::testing::TestWithParam<std::uint32_t> {
+  protected:
+    [[nodiscard]] static IntersectKernels const & kernels() {
+      return intersect_kernels(GetParam());
+    }
+
+    // Returns how many of the rays hit something.
+    static std::size_t check_rays(RenderScene const & rs, Generator & gen, std::size_t count) {
+      std::size_t hits = 0;
+      for (std::size_t i = 0; i < count; ++i) {
+        Ray const ray           = gen.ray();
+        HitRecord const bvh     = closest_hit(ray, rs, kernels());
+        HitRecord const linear  = closest_hit_linear(ray, rs);
+        expect_same_hit(bvh, linear, i);
+        hits                   += linear.hit ? 1U : 0U;
+      }
+      return hits;
+    }
+  };
+
+  TEST_P(ClosestHit, RandomRaysMatchLinearLoop) {
+    Generator gen(1);
+    RenderScene const rs = compile_scene(random_scene(gen, 300, 300));
+    std::size_t const hits = check_rays(rs, gen, 4000);
+    EXPECT_GT(hits, 1000U);
+  }
+
+  TEST_P(ClosestHit, SmallScenesMatchLinearLoop) {
+    for (std::size_t const spheres : {0U, 1U, 3U, 8U}) {
+      for (std::size_t const cylinders : {0U, 1U, 3U, 8U}) {
+        SCOPED_TRACE(std::to_string(spheres) + " spheres, " + std::to_string(cylinders) +
+                     " cylinders");
+        Generator gen(spheres * 16 + cylinders);
+        RenderScene const rs = compile_scene(random_scene(gen, spheres, cylinders));
+        check_rays(rs, gen, 500);
+      }
+    }
+  }
+
+  TEST_P(ClosestHit, EmptySceneMisses) {
+    RenderScene const rs = compile_scene(Scene{make_materials(), {}, {}});
+    Ray const ray{
+      {0.0, 0.0, 0.0},
+      {0.0, 0.0, -1.0}
+    };
+    expect_same_hit(closest_hit(ray, rs, kernels()), HitRecord{}, 0);
+  }
+
+  // Copies of the same primitive with other materials: every one is hit at the same t and
+  // the first in the file must win.
+  TEST_P(ClosestHit, TiesGoToTheLowerId) {
+    Generator gen(7);
+    Scene scene = random_scene(gen, 40, 40);
+    std::size_t const originals_s = scene.spheres.size();
+    std::size_t const originals_c = scene.cylinders.size();
+    for (std::uint32_t copy = 1; copy < 4; ++copy) {
+      for (std::size_t i = 0; i < originals_s; ++i) {
+        Sphere s      = scene.spheres[i];
+        s.material_id = (s.material_id + copy) % 4;
+        scene.spheres.push_back(s);
+      }
+      for (std::size_t i = 0; i < originals_c; ++i) {
+        Cylinder c    = scene.cylinders[i];
+        c.material_id = (c.material_id + copy) % 4;
+        scene.cylinders.push_back(c);
+      }
+    }
+    RenderScene const rs = compile_scene(scene);
+
+    for (std::size_t i = 0; i < originals_s + originals_c; ++i) {
+      bool const sphere = i < originals_s;
+      auto const center = sphere ? scene.spheres[i].center
+                                 : scene.cylinders[i - originals_s].base_center;
+      auto const origin = gen.point(ORIGIN_HALF_SIDE);
+      Ray const ray{
+        origin, {center[0] - origin[0], center[1] - origin[1], center[2] - origin[2]}
+      };
+      HitRecord const bvh    = closest_hit(ray, rs, kernels());
+      HitRecord const linear = closest_hit_linear(ray, rs);
+      expect_same_hit(bvh, linear, i);
+
+      // A ray aimed at the centre of an unobstructed original hits it first.
+      Scene single{scene.materials, {}, {}};
+      if (sphere) {
+        single.spheres.push_back(scene.spheres[i]);
+      } else {
+        single.cylinders.push_back(scene.cylinders[i - originals_s]);
+      }
+      HitRecord const alone = closest_hit_linear(ray, compile_scene(single));
+      if (alone.hit and alone.t == linear.t) {
+        EXPECT_EQ(material_index(bvh.material_id), material_index(alone.material_id))
+            << "ray " << i;
+      }
+    }
+  }
+
+  std::string kernel_name(::testing::TestParamInfo<std::uint32_t> const & info) {
+    return intersect_kernels(info.param).name;
+  }
+
+  INSTANTIATE_TEST_SUITE_P(Kernels, ClosestHit, ::testing::Range(0U, num_intersect_kernels()),
+                           kernel_name);
+
+}  // namespace
@@ -0,0 +1,78 @@
+#include "counter_rng.hpp"
+#include "sampler.hpp"
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace {
+
+  constexpr std::uint64_t SEED         = 1;  // the default of both seeds in the config
+  constexpr std::uint32_t SAMPLE_COUNT = 16;
+  constexpr std::uint32_t DRAWS        = 8;  // first two bounces of a Sampler
+  constexpr std::uint64_t PIXELS       = 64;
+
+  std::vector<double> draws(Sampler rng) {
+    std::vector<double> out;
+    for (std::uint32_t bounce = 0; bounce < 2; ++bounce) {
+      rng.set_bounce(bounce);
+      for (std::uint32_t d = 0; d < DRAWS / 2; ++d) {
+        out.push_back(rng.next_double());
+      }
+    }
+    return out;
+  }
+
+  class SamplerStreams : public ::testing::TestWithParam<SamplerType> {};
+
+  // The jitter of a camera sample and the first material draws of the same sample used to
+  // be the same numbers whenever the two seeds were equal.
+  TEST_P(SamplerStreams, RayAndMaterialStreamsDifferWithEqualSeeds) {
+    for (std::uint64_t pixel = 0; pixel < PIXELS; ++pixel) {
+      for (std::uint32_t sample = 0; sample < SAMPLE_COUNT; ++sample) {
+        auto const ray = draws(Sampler(GetParam(), SEED, RngStream::ray, pixel, sample,
+                                       SAMPLE_COUNT));
+        auto const material = draws(Sampler(GetParam(), SEED, RngStream::material, pixel, sample,
+                                            SAMPLE_COUNT));
+        for (std::size_t i = 0; i < ray.size(); ++i) {
+          EXPECT_NE(ray[i], material[i]) << "pixel " << pixel << " sample " << sample
+                                         << " draw " << i;
+        }
+      }
+    }
+  }
+
+  TEST_P(SamplerStreams, EachStreamIsReproducible) {
+    for (RngStream const stream : {RngStream::ray, RngStream::material}) {
+      EXPECT_EQ(draws(Sampler(GetParam(), SEED, stream, 5, 3, SAMPLE_COUNT)),
+                draws(Sampler(GetParam(), SEED, stream, 5, 3, SAMPLE_COUNT)));
+    }
+  }
+
+  std::string sampler_name(::testing::TestParamInfo<SamplerType> const & info) {
+    switch (info.param) {
+      case SamplerType::random: return "random";
+      case SamplerType::stratified: return "stratified";
+      case SamplerType::sobol: return "sobol";
+    }
+    return "unknown";
+  }
+
+  INSTANTIATE_TEST_SUITE_P(Types, SamplerStreams,
+                           ::testing::Values(SamplerType::random, SamplerType::stratified,
+                                             SamplerType::sobol),
+                           sampler_name);
+
+  TEST(CounterRng, StreamsDifferWithEqualSeeds) {
+    for (std::uint64_t pixel = 0; pixel < PIXELS; ++pixel) {
+      CounterRng ray(SEED, RngStream::ray, pixel, 0);
+      CounterRng material(SEED, RngStream::material, pixel, 0);
+      for (std::uint32_t i = 0; i < DRAWS; ++i) {
+        EXPECT_NE(ray.next_u64(), material.next_u64()) << "pixel " << pixel << " draw " << i;
+      }
+    }
+  }
+
+}  // namespace
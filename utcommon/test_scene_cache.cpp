@@ -0,0 +1,208 @@
+#include "render_scene.hpp"
+#include "scene.hpp"
+#include "scene_cache.hpp"
+#include "temp_dir.hpp"
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace {
+
+  namespace fs = std::filesystem;
+
+  constexpr std::uint64_t TEXT_HASH = 0x0123456789abcdefULL;
+  constexpr std::uint64_t TEXT_SIZE = 1234;
+
+  // Same layout as the file header in scene_cache.cpp: the section table follows it.
+  constexpr std::size_t HEADER_BYTES  = 48;
+  constexpr std::size_t SECTION_BYTES = 16;
+
+  Scene make_scene() {
+    Scene scene;
+    scene.materials = {
+      {"mate", MaterialType::Matte, {{0.1, 0.2, 0.3}}, {}, {}},
+      {"metal", MaterialType::Metal, {}, {{0.4, 0.5, 0.6}, 0.05}, {}},
+      {"vidrio", MaterialType::Refractive, {}, {}, {1.5}},
+    };
+    for (int i = 0; i < 40; ++i) {
+      double const x = static_cast<double>(i % 7) * 1.5;
+      double const z = static_cast<double>(i / 7) * 1.5;
+      scene.spheres.push_back({
+        {x, 0.0, z},
+        0.5, static_cast<std::uint32_t>(i % 3)
+      });
+      scene.cylinders.push_back({
+        {x, 2.0, z},
+        0.3, {0.0, 1.0, 0.1},
+        static_cast<std::uint32_t>((i + 1) % 3)
+      });
+    }
+    return scene;
+  }
+
+  std::vector<char> read_bytes(std::string const & path) {
+    std::ifstream in(path, std::ios::binary);
+    return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+  }
+
+  void write_bytes(std::string const & path, std::vector<char> const & bytes) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+  }
+
+  // Position of `array` in for_each_array order, i.e. its entry in the section table.
+  template <typename T>
+  std::size_t section_of(RenderScene const & rs, std::span<T const> const & array) {
+    std::size_t index = 0;
+    std::size_t found = 0;
+    for_each_array(rs, [&](auto const & a) {
+      if (static_cast<void const *>(&a) == static_cast<void const *>(&array)) {
+        found = index;
+      }
+      ++index;
+    });
+    return found;
+  }
+
+  // Overwrites element `element` of section `section` in the cache file with `value`.
+  template <typename T>
+  void poke(std::string const & path, std::size_t section, std::size_t element, T const & value) {
+    std::vector<char> bytes = read_bytes(path);
+    std::uint64_t offset{};
+    std::memcpy(&offset, bytes.data() + HEADER_BYTES + section * SECTION_BYTES, sizeof offset);
+    std::memcpy(bytes.data() + offset + element * sizeof(T), &value, sizeof(T));
+    write_bytes(path, bytes);
+  }
+
+  template <typename T>
+  std::vector<char> contents(std::span<T const> array) {
+    auto const * p = reinterpret_cast<char const *>(array.data());  // NOLINT
+    return {p, p + array.size_bytes()};
+  }
+
+}  // namespace
+
+TEST(SceneCache, RoundTripMapsIdenticalArrays) {
+  TempDir const dir;
+  std::string const path = dir.file("scene.scache");
+  RenderScene const rs   = compile_scene(make_scene());
+  write_scene_cache(path, TEXT_HASH, TEXT_SIZE, rs);
+
+  RenderScene loaded;
+  ASSERT_TRUE(load_scene_cache(path, TEXT_HASH, TEXT_SIZE, loaded));
+  EXPECT_EQ(loaded.bvh.num_spheres, rs.bvh.num_spheres);
+
+  std::vector<std::vector<char>> expected;
+  for_each_array(rs, [&](auto const & array) { expected.push_back(contents(array)); });
+  std::size_t i = 0;
+  for_each_array(loaded, [&](auto const & array) {
+    EXPECT_EQ(contents(array), expected.at(i)) << "array " << i;
+    ++i;
+  });
+  EXPECT_EQ(loaded.material_names.get(1), "metal");
+}
+
+TEST(SceneCache, RejectsOtherText) {
+  TempDir const dir;
+  std::string const path = dir.file("scene.scache");
+  write_scene_cache(path, TEXT_HASH, TEXT_SIZE, compile_scene(make_scene()));
+
+  RenderScene loaded;
+  EXPECT_FALSE(load_scene_cache(path, TEXT_HASH + 1, TEXT_SIZE, loaded));
+  EXPECT_FALSE(load_scene_cache(path, TEXT_HASH, TEXT_SIZE + 1, loaded));
+  EXPECT_FALSE(load_scene_cache(dir.file("missing.scache"), TEXT_HASH, TEXT_SIZE, loaded));
+}
+
+TEST(SceneCache, RejectsOutOfRangeIndices) {
+  RenderScene const rs     = compile_scene(make_scene());
+  auto const num_materials = static_cast<std::uint32_t>(rs.materials.size());
+  auto const num_spheres   = static_cast<std::uint32_t>(rs.num_spheres());
+  auto const num_nodes     = static_cast<std::uint32_t>(rs.bvh.nodes.size());
+  ASSERT_GT(num_nodes, 1U);
+
+  std::size_t const sphere_refs   = section_of(rs, rs.spheres.material_id);
+  std::size_t const sphere_ids    = section_of(rs, rs.spheres.id);
+  std::size_t const cylinder_refs = section_of(rs, rs.cylinders.material_id);
+  std::size_t const cylinder_ids  = section_of(rs, rs.cylinders.id);
+  std::size_t const nodes         = section_of(rs, rs.bvh.nodes);
+
+  BvhNode leaf_past_end{};
+  leaf_past_end.count  = 2;
+  leaf_past_end.offset = num_spheres - 1;
+  BvhNode self_loop{};
+  self_loop.offset = 0;
+  BvhNode child_past_end{};
+  child_past_end.offset = num_nodes;
+  BvhNode bad_axis      = rs.bvh.nodes[0];
+  bad_axis.axis         = 3;
+
+  struct Case {
+    char const * what;
+    std::function<void(std::string const &)> corrupt;
+  };
+
+  std::vector<Case> const cases{
+    {"sphere material index",
+     [&](std::string const & p) { poke(p, sphere_refs, 0, std::uint32_t{0x3FFFFFF0}); }},
+    {"sphere material type",
+     [&](std::string const & p) { poke(p, sphere_refs, 0, std::uint32_t{0xC0000000U}); }},
+    {"cylinder material index",
+     [&](std::string const & p) {
+       poke(p, cylinder_refs, 3, material_ref(MaterialType::Metal, num_materials));
+     }},
+    {"sphere id", [&](std::string const & p) { poke(p, sphere_ids, 1, num_spheres); }},
+    {"cylinder id", [&](std::string const & p) { poke(p, cylinder_ids, 1, std::uint32_t{0}); }},
+    {"leaf range", [&](std::string const & p) { poke(p, nodes, 0, leaf_past_end); }},
+    {"child cycle", [&](std::string const & p) { poke(p, nodes, 0, self_loop); }},
+    {"child index", [&](std::string const & p) { poke(p, nodes, 0, child_past_end); }},
+    {"split axis", [&](std::string const & p) { poke(p, nodes, 0, bad_axis); }},
+  };
+
+  TempDir const dir;
+  for (Case const & c : cases) {
+    std::string const path = dir.file("scene.scache");
+    write_scene_cache(path, TEXT_HASH, TEXT_SIZE, rs);
+    c.corrupt(path);
+    RenderScene loaded;
+    EXPECT_FALSE(load_scene_cache(path, TEXT_HASH, TEXT_SIZE, loaded)) << c.what;
+  }
+}
+
+TEST(SceneCache, CorruptCacheIsRebuilt) {
+  TempDir const dir;
+  std::string const scene_path = dir.write("scene.txt",
+                                          "matte: gris 0.5 0.5 0.5\n"
+                                          "metal: espejo 0.9 0.9 0.9 0.0\n"
+                                          "sphere: 0 0 -3 1 gris\n"
+                                          "sphere: 2 0 -3 1 espejo\n"
+                                          "cylinder: 0 -1 -5 0.5 0 2 0 gris\n");
+
+  LoadedScene const first = load_render_scene(scene_path, true);
+  EXPECT_EQ(first.source, SceneSource::stored);
+  LoadedScene const second = load_render_scene(scene_path, true);
+  ASSERT_EQ(second.source, SceneSource::cached);
+
+  std::string cache_path;
+  for (auto const & entry : fs::directory_iterator(dir.path())) {
+    if (entry.path().extension() == ".scache") {
+      cache_path = entry.path().string();
+    }
+  }
+  ASSERT_FALSE(cache_path.empty());
+  poke(cache_path, section_of(second.scene, second.scene.spheres.material_id), 0,
+       std::uint32_t{0x3FFFFFF0});
+
+  LoadedScene const third = load_render_scene(scene_path, true);
+  EXPECT_EQ(third.source, SceneSource::stored);
+  EXPECT_EQ(contents(third.scene.spheres.material_id), contents(first.scene.spheres.material_id));
+  EXPECT_EQ(load_render_scene(scene_path, true).source, SceneSource::cached);
+}
@@ -0,0 +1,231 @@
+#include "scene.hpp"
+#include "temp_dir.hpp"
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <limits>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+// Golden diagnostics of the scene parser. The messages are those of the original
+// line-by-line istringstream parser; the chunked parser has to print the same one for the
+// same first failing line, whichever chunk it falls in.
+
+namespace {
+
+  // Scene files are split into chunks of this many bytes (CHUNK_BYTES in scene.cpp).
+  constexpr std::size_t CHUNK_BYTES = std::size_t{1} << 20U;
+
+  constexpr std::string_view FILLER = "sphere: 1 2 3 0.5 m\n";
+
+  // A scene of two chunks whose boundary is the end of `middle`: about a chunk of filler
+  // objects, then before and middle, then after and as much filler again. The split point
+  // of the file, its midpoint, falls inside middle.
+  std::string around_chunk_boundary(std::string_view before, std::string_view middle,
+                                    std::string_view after) {
+    std::string left = "matte: m 1 1 1\n";
+    while (left.size() < CHUNK_BYTES + CHUNK_BYTES / 10) {
+      left += FILLER;
+    }
+    left += before;
+    std::string right{after};
+    while (right.size() + FILLER.size() <= left.size()) {
+      right += FILLER;
+    }
+    if (std::size_t const pad = left.size() - right.size(); pad > 0) {
+      right += pad > 1 ? "#" + std::string(pad - 2, 'x') + "\n" : "\n";
+    }
+    return left + std::string{middle} + right;
+  }
+
+  // Regular expression that matches exactly text.
+  std::string exactly(std::string_view text) {
+    std::string re = "^";
+    for (char const c : text) {
+      if (std::string_view{"\\^$.|?*+()[]{}"}.find(c) != std::string_view::npos) {
+        re += '\\';
+      }
+      re += c;
+    }
+    return re + "$";
+  }
+
+  struct ErrorCase {
+    char const * name;
+    std::string text;
+    char const * message;
+
+    friend std::ostream & operator<<(std::ostream & os, ErrorCase const & c) {
+      return os << c.name;
+    }
+  };
+
+  // parse_scene prints the error and exits; the parser runs on TBB threads.
+  class SceneParserError : public ::testing::TestWithParam<ErrorCase> {
+  protected:
+    void SetUp() override { GTEST_FLAG_SET(death_test_style, "threadsafe"); }
+  };
+
+  TEST_P(SceneParserError, PrintsGoldenMessage) {
+    TempDir const dir;
+    std::string const path = dir.write("scene.txt", GetParam().text);
+    EXPECT_EXIT(parse_scene(path), ::testing::ExitedWithCode(EXIT_FAILURE),
+                exactly(GetParam().message));
+  }
+
+  std::string case_name(::testing::TestParamInfo<ErrorCase> const & info) {
+    return info.param.name;
+  }
+
+  char const * const INVALID_SPHERE     = "Error: Invalid object parameters for: [sphere]\n";
+  char const * const INVALID_MATTE      = "Error: Invalid material parameters for: [matte]\n";
+  char const * const INVALID_REFRACTIVE = "Error: Invalid material parameters for: [refractive]\n";
+
+  INSTANTIATE_TEST_SUITE_P(
+      MalformedNumbers, SceneParserError,
+      ::testing::Values(
+          ErrorCase{"TwoDots", "matte: m 1 1 1\nsphere: 1.2.3 0 0 1 m\n", INVALID_SPHERE},
+          ErrorCase{"Letters", "matte: m 0.5 abc 0.5\n", INVALID_MATTE},
+          ErrorCase{"BareExponent", "matte: m 1 1 1\nsphere: 0 0 0 1e m\n", INVALID_SPHERE},
+          ErrorCase{"ExponentSignOnly", "refractive: m 1e+\n", INVALID_REFRACTIVE},
+          ErrorCase{"SignOnly", "matte: m - 0.5 0.5\n", INVALID_MATTE},
+          ErrorCase{"DoubleSign", "refractive: m --1\n", INVALID_REFRACTIVE},
+          ErrorCase{"DotOnly", "matte: m 1 1 1\nsphere: 0 0 0 . m\n", INVALID_SPHERE},
+          ErrorCase{"Infinity", "metal: m 1 1 1 inf\n",
+                    "Error: Invalid material parameters for: [metal]\n"},
+          ErrorCase{"NaN", "refractive: m nan\n", INVALID_REFRACTIVE},
+          ErrorCase{"Hex", "refractive: m 0x1p3\n", INVALID_REFRACTIVE},
+          ErrorCase{"SuffixBecomesNextField", "matte: m 1 1 1\nsphere: 0 0 0 0.5x m\n",
+                    "Error: Extra data after material parameters for: [sphere] (Extra: m)\n"}),
+      case_name);
+
+  INSTANTIATE_TEST_SUITE_P(
+      ExponentOverflow, SceneParserError,
+      ::testing::Values(
+          ErrorCase{"Positive", "refractive: m 1e309\n", INVALID_REFRACTIVE},
+          ErrorCase{"Negative", "matte: m 1 1 1\nsphere: -1e309 0 0 1 m\n", INVALID_SPHERE},
+          ErrorCase{"HugeExponent", "refractive: m 1e99999999999999999999\n",
+                    INVALID_REFRACTIVE},
+          ErrorCase{"MantissaPastMax", "refractive: m 17976931348623159e292\n",
+                    INVALID_REFRACTIVE}),
+      case_name);
+
+  INSTANTIATE_TEST_SUITE_P(
+      Materials, SceneParserError,
+      ::testing::Values(
+          ErrorCase{"Duplicate", "matte: m 1 1 1\nmetal: m 1 1 1 0\n",
+                    "Error: Material with name [m] already exists\n"},
+          // The name is checked before the parameters.
+          ErrorCase{"DuplicateWithBadParameters", "matte: m 1 1 1\nmatte: m bad\n",
+                    "Error: Material with name [m] already exists\n"},
+          ErrorCase{"UnknownBeforeDuplicate",
+                    "sphere: 0 0 0 1 x\nmatte: m 1 1 1\nmatte: m 1 1 1\n",
+                    "Error: Material not found: [x]\n"},
+          ErrorCase{"Unknown", "matte: m 1 1 1\nsphere: 0 0 0 1 nope\n",
+                    "Error: Material not found: [nope]\n"},
+          ErrorCase{"ForwardReferenceSphere", "sphere: 0 0 0 1 later\nmatte: later 1 1 1\n",
+                    "Error: Material not found: [later]\n"},
+          ErrorCase{"ForwardReferenceCylinder",
+                    "cylinder: 0 0 0 1 0 1 0 later\nmatte: later 1 1 1\n",
+                    "Error: Material not found: [later]\n"},
+          ErrorCase{"UnknownEntity", "plane: 0 0 0\n", "Error: Unknown scene entity: plane\n"},
+          ErrorCase{"ExtraFields", "matte: m 1 1 1\nsphere: 0 0 0 1 m extra  stuff\n",
+                    "Error: Extra data after material parameters for: [sphere] "
+                    "(Extra: extra stuff)\n"}),
+      case_name);
+
+  INSTANTIATE_TEST_SUITE_P(
+      ChunkBoundary, SceneParserError,
+      ::testing::Values(
+          ErrorCase{"LastLineOfFirstChunk",
+                    around_chunk_boundary("", "sphere: 0 0 0 -1 m\n", ""), INVALID_SPHERE},
+          ErrorCase{"FirstLineOfSecondChunk",
+                    around_chunk_boundary("", "sphere: 0 0 0 1 m\n", "sphere: 0 0 0 -1 m\n"),
+                    INVALID_SPHERE},
+          ErrorCase{"FirstChunkWins",
+                    around_chunk_boundary("", "plane: 1\n", "sphere: 0 0 0 -1 m\n"),
+                    "Error: Unknown scene entity: plane\n"},
+          ErrorCase{"UnknownMaterialBeforeSyntaxError",
+                    around_chunk_boundary("sphere: 0 0 0 1 nope\n", "sphere: 0 0 0 1 m\n",
+                                          "plane: 2\n"),
+                    "Error: Material not found: [nope]\n"},
+          ErrorCase{"SyntaxErrorBeforeUnknownMaterial",
+                    around_chunk_boundary("", "sphere: 0 0 0 1e m\n", "sphere: 0 0 0 1 nope\n"),
+                    INVALID_SPHERE},
+          ErrorCase{"ForwardReference",
+                    around_chunk_boundary("", "sphere: 0 0 0 1 later\n", "matte: later 1 1 1\n"),
+                    "Error: Material not found: [later]\n"},
+          ErrorCase{"Duplicate",
+                    around_chunk_boundary("", "matte: twice 1 1 1\n", "metal: twice 1 1 1 0\n"),
+                    "Error: Material with name [twice] already exists\n"},
+          ErrorCase{"DuplicateWithBadParameters",
+                    around_chunk_boundary("matte: twice 1 1 1\n", "matte: twice 1 1\n", ""),
+                    "Error: Material with name [twice] already exists\n"},
+          // A failed line does not define its material, so a later one of that name is new.
+          ErrorCase{"BadParametersBeforeDuplicate",
+                    around_chunk_boundary("", "matte: twice 1 1 x\n", "matte: twice 1 1 1\n"),
+                    INVALID_MATTE}),
+      case_name);
+
+  // Parses text, which must be valid.
+  Scene parse_text(std::string_view text) {
+    TempDir const dir;
+    return parse_scene(dir.write("scene.txt", text));
+  }
+
+  double refractive_index(std::string_view number) {
+    Scene const scene = parse_text("refractive: m " + std::string{number} + "\n");
+    return scene.materials.at(0).refr.index;
+  }
+
+  double sphere_x(std::string_view number) {
+    Scene const scene = parse_text("matte: m 1 1 1\nsphere: " + std::string{number} + " 0 0 1 m\n");
+    return scene.spheres.at(0).center[0];
+  }
+
+  // Past 2^53 the digits no longer fit a double; the value is rounded to nearest even, as
+  // istringstream did.
+  TEST(SceneParserNumbers, MantissaAboveTwoToThe53) {
+    EXPECT_EQ(refractive_index("9007199254740993"), 0x1p+53);
+    EXPECT_EQ(refractive_index("9007199254740995"), 0x1.0000000000002p+53);
+    EXPECT_EQ(sphere_x("-9007199254740993"), -0x1p+53);
+    EXPECT_EQ(refractive_index("9999999999999999999"), 0x1.158e460913dp+63);
+    EXPECT_EQ(refractive_index("18446744073709551617"), 0x1p+64);
+    EXPECT_EQ(refractive_index("0.12345678901234567890123"), 0x1.f9add3746f65fp-4);
+    EXPECT_EQ(refractive_index("1.0000000000000002220446"), 0x1.0000000000001p+0);
+  }
+
+  TEST(SceneParserNumbers, ExponentLimits) {
+    EXPECT_EQ(refractive_index("1.7976931348623157e308"), std::numeric_limits<double>::max());
+    EXPECT_EQ(sphere_x("4.9e-324"), std::numeric_limits<double>::denorm_min());
+    EXPECT_EQ(sphere_x("1e-400"), 0.0);
+  }
+
+  TEST(SceneParserNumbers, PartialForms) {
+    EXPECT_EQ(refractive_index("+.5"), 0.5);
+    EXPECT_EQ(refractive_index("5."), 5.0);
+  }
+
+  // Objects on both sides of the boundary keep file order and resolve materials defined
+  // in either chunk.
+  TEST(SceneParserChunks, ResolvesAcrossChunkBoundary) {
+    Scene const scene = parse_text(around_chunk_boundary(
+        "matte: early 1 1 1\n", "sphere: 0 0 0 1 early\n",
+        "cylinder: 0 0 0 1 0 1 0 early\nmatte: late 0.5 0.5 0.5\nsphere: 0 0 0 2 late\n"));
+    ASSERT_EQ(scene.materials.size(), 3U);
+    EXPECT_EQ(scene.materials[1].name, "early");
+    EXPECT_EQ(scene.materials[2].name, "late");
+    auto const early = std::ranges::find(scene.spheres, 1.0, &Sphere::radius);
+    ASSERT_NE(early, scene.spheres.end());
+    ASSERT_NE(early + 1, scene.spheres.end());
+    EXPECT_EQ(early->material_id, 1U);
+    EXPECT_EQ((early + 1)->radius, 2.0);
+    EXPECT_EQ((early + 1)->material_id, 2U);
+    ASSERT_EQ(scene.cylinders.size(), 1U);
+    EXPECT_EQ(scene.cylinders[0].material_id, 1U);
+  }
+
+}  // namespace
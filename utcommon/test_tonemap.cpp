@@ -0,0 +1,136 @@
+#include "tonemap.hpp"
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace {
+
+  // The per-pixel pow the tone mapper replaced.
+  std::uint8_t pow_byte(double v, double gamma) {
+    v = std::clamp(v, 0.0, 1.0);
+    if (gamma > 0.0) {
+      v = std::pow(v, 1.0 / gamma);
+    }
+    return static_cast<std::uint8_t>(std::clamp(v * 255.0, 0.0, 255.0));
+  }
+
+  // Inputs within this relative distance of a quantisation threshold may come out one step
+  // off; everything else has to match pow exactly.
+  constexpr double NEAR_THRESHOLD = 1e-6;
+
+  bool near_threshold(double v, double gamma) {
+    return pow_byte(v * (1.0 - NEAR_THRESHOLD), gamma) !=
+           pow_byte(v * (1.0 + NEAR_THRESHOLD), gamma);
+  }
+
+  // Zero, tiny and subnormal values, a log sweep up past 1, and every threshold with its
+  // float neighbours.
+  std::vector<float> sample_inputs(double gamma) {
+    std::vector<float> in{0.0F, -0.0F, -1.0F, 1.0F, 2.0F, std::numeric_limits<float>::denorm_min(),
+                          std::numeric_limits<float>::min(),
+                          std::numeric_limits<float>::quiet_NaN()};
+    for (double v = 1e-40; v < 4.0; v *= 1.003) {
+      in.push_back(float(v));
+    }
+    for (int k = 1; k <= 255; ++k) {
+      double const x = double(k) / 255.0;
+      auto const t   = float(gamma > 0.0 ? std::pow(x, gamma) : x);
+      in.push_back(t);
+      in.push_back(std::nextafter(t, 0.0F));
+      in.push_back(std::nextafter(t, 2.0F));
+    }
+    return in;
+  }
+
+  void expect_matches_pow(std::uint8_t actual, double v, double gamma, char const * what) {
+    std::uint8_t const expected = pow_byte(std::isnan(v) ? 0.0 : v, gamma);
+    if (near_threshold(v, gamma)) {
+      EXPECT_LE(std::abs(int(actual) - int(expected)), 1) << what << " v=" << v;
+    } else {
+      EXPECT_EQ(int(actual), int(expected)) << what << " v=" << v;
+    }
+  }
+
+  // Gammas inside and outside what the table holds, linear output included.
+  constexpr double GAMMAS[] = {0.0, 0.001, 0.05, 0.5, 1.0, 1.8, 2.2, 3.0,  // NOLINT
+                               5.0, 10.0,  15.0, 16.0, 20.0, 40.0, 200.0};
+  constexpr float EXPOSURES[] = {0.25F, 1.0F, 3.0F};  // NOLINT
+
+  class ToneMapperKernel : public ::testing::TestWithParam<std::uint32_t> {};
+
+  TEST_P(ToneMapperKernel, ScaledPlaneMatchesPow) {
+    for (double const gamma : GAMMAS) {
+      SCOPED_TRACE("gamma " + std::to_string(gamma));
+      ToneMapper const tone(gamma);
+      std::vector<float> const in = sample_inputs(gamma);
+      std::vector<std::uint8_t> out(in.size());
+      for (float const exposure : EXPOSURES) {
+        SCOPED_TRACE("exposure " + std::to_string(exposure));
+        tone.apply(in.data(), exposure, in.size(), out.data(), GetParam());
+        for (std::size_t i = 0; i < in.size(); ++i) {
+          expect_matches_pow(out[i], double(in[i] * exposure), gamma, "plane");
+        }
+      }
+    }
+  }
+
+  TEST_P(ToneMapperKernel, AveragedPlaneMatchesPow) {
+    for (double const gamma : GAMMAS) {
+      SCOPED_TRACE("gamma " + std::to_string(gamma));
+      ToneMapper const tone(gamma);
+      std::vector<float> const in = sample_inputs(gamma);
+      std::vector<float> sums(in.size());
+      std::vector<std::uint32_t> counts(in.size());
+      for (std::size_t i = 0; i < in.size(); ++i) {
+        counts[i] = std::uint32_t(1 + i % 7);
+        sums[i]   = in[i] * float(counts[i]);
+      }
+      std::vector<std::uint8_t> out(in.size());
+      tone.apply(sums.data(), counts.data(), in.size(), out.data(), GetParam());
+      for (std::size_t i = 0; i < in.size(); ++i) {
+        expect_matches_pow(out[i], double(sums[i] / float(counts[i])), gamma, "mean");
+      }
+    }
+  }
+
+  std::string kernel_name(::testing::TestParamInfo<std::uint32_t> const & info) {
+    return tonemap_kernel_name(info.param);
+  }
+
+  INSTANTIATE_TEST_SUITE_P(Kernels, ToneMapperKernel, ::testing::Range(0U, num_tonemap_kernels()),
+                           kernel_name);
+
+  TEST(ToneMapper, DoublesMatchPow) {
+    for (double const gamma : GAMMAS) {
+      SCOPED_TRACE("gamma " + std::to_string(gamma));
+      ToneMapper const tone(gamma);
+      for (float const v : sample_inputs(gamma)) {
+        expect_matches_pow(tone(double(v)), double(v), gamma, "double");
+      }
+    }
+  }
+
+  TEST(ToneMapper, BlackAndWhiteAtEveryGamma) {
+    for (double const gamma : GAMMAS) {
+      ToneMapper const tone(gamma);
+      EXPECT_EQ(tone(0.0), 0) << "gamma " << gamma;
+      EXPECT_EQ(tone(1.0), 255) << "gamma " << gamma;
+    }
+  }
+
+  // Past the normal float range, or with thresholds too close for the finest bins, the
+  // table is not built and pow is used.
+  TEST(ToneMapper, FallsBackToPowOutsideTheTable) {
+    EXPECT_FALSE(ToneMapper(2.2).exact());
+    EXPECT_FALSE(ToneMapper(15.0).exact());
+    EXPECT_TRUE(ToneMapper(16.0).exact());
+    EXPECT_TRUE(ToneMapper(0.001).exact());
+  }
+
+}  // namespace